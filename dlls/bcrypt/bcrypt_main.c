@@ -421,8 +421,8 @@ struct hash
     struct object     hdr;
     enum alg_id       alg_id;
     ULONG             flags;
-    UCHAR            *secret;
-    ULONG             secret_len;
+    struct hash_impl  outer_key; /* initial states, after absorbing the padded key for hmac */
+    struct hash_impl  inner_key;
     struct hash_impl  outer;
     struct hash_impl  inner;
 };
@@ -761,33 +761,54 @@ NTSTATUS WINAPI BCryptGetProperty( BCRYPT_HANDLE handle, LPCWSTR prop, UCHAR *bu
     }
 }
 
-static NTSTATUS hash_prepare( struct hash *hash )
+static NTSTATUS hmac_init( struct hash *hash, UCHAR *secret, ULONG secret_len )
 {
     UCHAR buffer[MAX_HASH_BLOCK_BITS / 8] = {0};
     int block_bytes, i;
     NTSTATUS status;
 
-    /* initialize hash */
-    if ((status = hash_init( &hash->inner, hash->alg_id ))) return status;
-    if (!(hash->flags & HASH_FLAG_HMAC)) return STATUS_SUCCESS;
+    if ((status = hash_init( &hash->outer_key, hash->alg_id ))) return status;
+    if ((status = hash_init( &hash->inner_key, hash->alg_id ))) return status;
 
-    /* initialize hmac */
-    if ((status = hash_init( &hash->outer, hash->alg_id ))) return status;
     block_bytes = builtin_algorithms[hash->alg_id].block_bits / 8;
-    if (hash->secret_len > block_bytes)
+    if (secret_len > block_bytes)
     {
         struct hash_impl temp;
         if ((status = hash_init( &temp, hash->alg_id ))) return status;
-        if ((status = hash_update( &temp, hash->alg_id, hash->secret, hash->secret_len ))) return status;
+        if ((status = hash_update( &temp, hash->alg_id, secret, secret_len ))) return status;
         if ((status = hash_finish( &temp, hash->alg_id, buffer,
                                    builtin_algorithms[hash->alg_id].hash_length ))) return status;
     }
-    else memcpy( buffer, hash->secret, hash->secret_len );
+    else if (secret_len) memcpy( buffer, secret, secret_len );
 
     for (i = 0; i < block_bytes; i++) buffer[i] ^= 0x5c;
-    if ((status = hash_update( &hash->outer, hash->alg_id, buffer, block_bytes ))) return status;
+    if ((status = hash_update( &hash->outer_key, hash->alg_id, buffer, block_bytes ))) return status;
     for (i = 0; i < block_bytes; i++) buffer[i] ^= (0x5c ^ 0x36);
-    return hash_update( &hash->inner, hash->alg_id, buffer, block_bytes );
+    status = hash_update( &hash->inner_key, hash->alg_id, buffer, block_bytes );
+    SecureZeroMemory( buffer, sizeof(buffer) );
+    return status;
+}
+
+static void hash_prepare( struct hash *hash )
+{
+    /* any padded key has already been absorbed, start from the saved states */
+    hash->inner = hash->inner_key;
+    if (hash->flags & HASH_FLAG_HMAC) hash->outer = hash->outer_key;
+}
+
+static NTSTATUS hash_complete( const struct hash *hash, struct hash_impl *inner, struct hash_impl *outer,
+                               UCHAR *output, ULONG size )
+{
+    UCHAR buffer[MAX_HASH_OUTPUT_BYTES];
+    int hash_length;
+    NTSTATUS status;
+
+    if (!(hash->flags & HASH_FLAG_HMAC)) return hash_finish( inner, hash->alg_id, output, size );
+
+    hash_length = builtin_algorithms[hash->alg_id].hash_length;
+    if ((status = hash_finish( inner, hash->alg_id, buffer, hash_length ))) return status;
+    if ((status = hash_update( outer, hash->alg_id, buffer, hash_length ))) return status;
+    return hash_finish( outer, hash->alg_id, output, size );
 }
 
 static NTSTATUS hash_create( const struct algorithm *alg, UCHAR *secret, ULONG secret_len, ULONG flags,
@@ -803,20 +824,14 @@ static NTSTATUS hash_create( const struct algorithm *alg, UCHAR *secret, ULONG s
     if ((alg->flags & BCRYPT_HASH_REUSABLE_FLAG) || (flags & BCRYPT_HASH_REUSABLE_FLAG))
         hash->flags |= HASH_FLAG_REUSABLE;
 
-    if (secret_len && !(hash->secret = malloc( secret_len )))
+    if (hash->flags & HASH_FLAG_HMAC) status = hmac_init( hash, secret, secret_len );
+    else status = hash_init( &hash->inner_key, hash->alg_id );
+    if (status)
     {
-        free( hash );
-        return STATUS_NO_MEMORY;
-    }
-    memcpy( hash->secret, secret, secret_len );
-    hash->secret_len = secret_len;
-
-    if ((status = hash_prepare( hash )))
-    {
-        free( hash->secret );
         free( hash );
         return status;
     }
+    hash_prepare( hash );
 
     *ret_hash = hash;
     return STATUS_SUCCESS;
@@ -860,12 +875,6 @@ NTSTATUS WINAPI BCryptDuplicateHash( BCRYPT_HASH_HANDLE handle, BCRYPT_HASH_HAND
     if (!(hash_copy = malloc( sizeof(*hash_copy) ))) return STATUS_NO_MEMORY;
 
     memcpy( hash_copy, hash_orig, sizeof(*hash_orig) );
-    if (hash_orig->secret && !(hash_copy->secret = malloc( hash_orig->secret_len )))
-    {
-        free( hash_copy );
-        return STATUS_NO_MEMORY;
-    }
-    memcpy( hash_copy->secret, hash_orig->secret, hash_orig->secret_len );
 
     *handle_copy = hash_copy;
     return STATUS_SUCCESS;
@@ -875,7 +884,7 @@ static void hash_destroy( struct hash *hash )
 {
     if (!hash) return;
     hash->hdr.magic = 0;
-    free( hash->secret );
+    SecureZeroMemory( hash, sizeof(*hash) );
     free( hash );
 }
 
@@ -904,23 +913,10 @@ NTSTATUS WINAPI BCryptHashData( BCRYPT_HASH_HANDLE handle, UCHAR *input, ULONG s
 
 static NTSTATUS hash_finalize( struct hash *hash, UCHAR *output, ULONG size )
 {
-    UCHAR buffer[MAX_HASH_OUTPUT_BYTES];
-    int hash_length;
     NTSTATUS status;
 
-    if (!(hash->flags & HASH_FLAG_HMAC))
-    {
-        if ((status = hash_finish( &hash->inner, hash->alg_id, output, size ))) return status;
-        if (hash->flags & HASH_FLAG_REUSABLE) return hash_prepare( hash );
-        return STATUS_SUCCESS;
-    }
-
-    hash_length = builtin_algorithms[hash->alg_id].hash_length;
-    if ((status = hash_finish( &hash->inner, hash->alg_id, buffer, hash_length ))) return status;
-    if ((status = hash_update( &hash->outer, hash->alg_id, buffer, hash_length ))) return status;
-    if ((status = hash_finish( &hash->outer, hash->alg_id, output, size ))) return status;
-
-    if (hash->flags & HASH_FLAG_REUSABLE) return hash_prepare( hash );
+    if ((status = hash_complete( hash, &hash->inner, &hash->outer, output, size ))) return status;
+    if (hash->flags & HASH_FLAG_REUSABLE) hash_prepare( hash );
     return STATUS_SUCCESS;
 }
 
@@ -1956,12 +1952,12 @@ NTSTATUS WINAPI BCryptDeriveKeyCapi( BCRYPT_HASH_HANDLE handle, BCRYPT_ALG_HANDL
             pad2[i] = 0x5c ^ (i < len ? buf[i] : 0);
         }
 
-        if ((status = hash_prepare( hash )) ||
-            (status = hash_update( &hash->inner, hash->alg_id, pad1, sizeof(pad1) )) ||
+        hash_prepare( hash );
+        if ((status = hash_update( &hash->inner, hash->alg_id, pad1, sizeof(pad1) )) ||
             (status = hash_finalize( hash, buf, len ))) return status;
 
-        if ((status = hash_prepare( hash )) ||
-            (status = hash_update( &hash->inner, hash->alg_id, pad2, sizeof(pad2) )) ||
+        hash_prepare( hash );
+        if ((status = hash_update( &hash->inner, hash->alg_id, pad2, sizeof(pad2) )) ||
             (status = hash_finalize( hash, buf + len, len ))) return status;
     }
 
@@ -1969,51 +1965,40 @@ NTSTATUS WINAPI BCryptDeriveKeyCapi( BCRYPT_HASH_HANDLE handle, BCRYPT_ALG_HANDL
     return STATUS_SUCCESS;
 }
 
-static NTSTATUS pbkdf2( struct hash *hash, UCHAR *pwd, ULONG pwd_len, UCHAR *salt, ULONG salt_len,
-                        ULONGLONG iterations, ULONG i, UCHAR *dst, ULONG hash_len )
+/* compute block i of the derived key, restarting each iteration from the saved key states */
+static NTSTATUS pbkdf2( const struct hash *hash, UCHAR *salt, ULONG salt_len, ULONGLONG iterations, ULONG i,
+                        UCHAR *dst, ULONG hash_len )
 {
-    NTSTATUS status = STATUS_INVALID_PARAMETER;
-    UCHAR bytes[4], *buf;
-    ULONG j, k;
-
-    if (!(buf = malloc( hash_len ))) return STATUS_NO_MEMORY;
-
-    for (j = 0; j < iterations; j++)
-    {
-        if (j == 0)
-        {
-            /* use salt || INT(i) */
-            if ((status = hash_update( &hash->inner, hash->alg_id, salt, salt_len )))
-            {
-                free( buf );
-                return status;
-            }
-            bytes[0] = (i >> 24) & 0xff;
-            bytes[1] = (i >> 16) & 0xff;
-            bytes[2] = (i >> 8) & 0xff;
-            bytes[3] = i & 0xff;
-            status = hash_update( &hash->inner, hash->alg_id, bytes, 4 );
-        }
-        else status = hash_update( &hash->inner, hash->alg_id, buf, hash_len ); /* use U_j */
-
-        if (status)
-        {
-            free( buf );
-            return status;
-        }
-
-        if ((status = hash_finalize( hash, buf, hash_len )))
-        {
-            free( buf );
-            return status;
-        }
-
-        if (j == 0) memcpy( dst, buf, hash_len );
-        else for (k = 0; k < hash_len; k++) dst[k] ^= buf[k];
-    }
-
-    free( buf );
-    return status;
+    struct hash_impl inner, outer;
+    UCHAR bytes[4], buf[MAX_HASH_OUTPUT_BYTES];
+    ULONGLONG j;
+    NTSTATUS status;
+    ULONG k;
+
+    /* U_1 = PRF(P, salt || INT(i)) */
+    bytes[0] = (i >> 24) & 0xff;
+    bytes[1] = (i >> 16) & 0xff;
+    bytes[2] = (i >> 8) & 0xff;
+    bytes[3] = i & 0xff;
+    inner = hash->inner_key;
+    outer = hash->outer_key;
+    if ((status = hash_update( &inner, hash->alg_id, salt, salt_len )) ||
+        (status = hash_update( &inner, hash->alg_id, bytes, 4 )) ||
+        (status = hash_complete( hash, &inner, &outer, buf, hash_len ))) return status;
+    memcpy( dst, buf, hash_len );
+
+    /* U_j = PRF(P, U_j-1) */
+    for (j = 1; j < iterations; j++)
+    {
+        inner = hash->inner_key;
+        outer = hash->outer_key;
+        if ((status = hash_update( &inner, hash->alg_id, buf, hash_len )) ||
+            (status = hash_complete( hash, &inner, &outer, buf, hash_len ))) return status;
+        for (k = 0; k < hash_len; k++) dst[k] ^= buf[k];
+    }
+
+    SecureZeroMemory( buf, sizeof(buf) );
+    return STATUS_SUCCESS;
 }
 
 NTSTATUS WINAPI BCryptDeriveKeyPBKDF2( BCRYPT_ALG_HANDLE handle, UCHAR *pwd, ULONG pwd_len, UCHAR *salt, ULONG salt_len,
@@ -2021,8 +2006,8 @@ NTSTATUS WINAPI BCryptDeriveKeyPBKDF2( BCRYPT_ALG_HANDLE handle, UCHAR *pwd, ULO
 {
     struct algorithm *alg = handle;
     ULONG hash_len, block_count, bytes_left, i;
+    UCHAR partial[MAX_HASH_OUTPUT_BYTES];
     struct hash *hash;
-    UCHAR *partial;
     NTSTATUS status;
 
     TRACE( "%p, %p, %u, %p, %u, %s, %p, %u, %08x\n", handle, pwd, pwd_len, salt, salt_len,
@@ -2032,6 +2017,7 @@ NTSTATUS WINAPI BCryptDeriveKeyPBKDF2( BCRYPT_ALG_HANDLE handle, UCHAR *pwd, ULO
 
     hash_len = builtin_algorithms[alg->id].hash_length;
     if (dk_len <= 0 || dk_len > ((((ULONGLONG)1) << 32) - 1) * hash_len) return STATUS_INVALID_PARAMETER;
+    if (!iterations) return STATUS_INVALID_PARAMETER;
 
     block_count = 1 + ((dk_len - 1) / hash_len); /* ceil(dk_len / hash_len) */
     bytes_left = dk_len - (block_count - 1) * hash_len;
@@ -2041,7 +2027,7 @@ NTSTATUS WINAPI BCryptDeriveKeyPBKDF2( BCRYPT_ALG_HANDLE handle, UCHAR *pwd, ULO
     /* full blocks */
     for (i = 1; i < block_count; i++)
     {
-        if ((status = pbkdf2( hash, pwd, pwd_len, salt, salt_len, iterations, i, dk + ((i - 1) * hash_len), hash_len )))
+        if ((status = pbkdf2( hash, salt, salt_len, iterations, i, dk + ((i - 1) * hash_len), hash_len )))
         {
             hash_destroy( hash );
             return status;
@@ -2049,23 +2035,12 @@ NTSTATUS WINAPI BCryptDeriveKeyPBKDF2( BCRYPT_ALG_HANDLE handle, UCHAR *pwd, ULO
     }
 
     /* final partial block */
-    if (!(partial = malloc( hash_len )))
-    {
-        hash_destroy( hash );
-        return STATUS_NO_MEMORY;
-    }
-
-    if ((status = pbkdf2( hash, pwd, pwd_len, salt, salt_len, iterations, block_count, partial, hash_len )))
-    {
-        hash_destroy( hash );
-        free( partial );
-        return status;
-    }
-    memcpy( dk + ((block_count - 1) * hash_len), partial, bytes_left );
+    if (!(status = pbkdf2( hash, salt, salt_len, iterations, block_count, partial, hash_len )))
+        memcpy( dk + ((block_count - 1) * hash_len), partial, bytes_left );
 
+    SecureZeroMemory( partial, sizeof(partial) );
     hash_destroy( hash );
-    free( partial );
-    return STATUS_SUCCESS;
+    return status;
 }
 
 NTSTATUS WINAPI BCryptSecretAgreement(BCRYPT_KEY_HANDLE privatekey, BCRYPT_KEY_HANDLE publickey, BCRYPT_SECRET_HANDLE *handle, ULONG flags)
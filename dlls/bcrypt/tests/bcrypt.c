@@ -378,6 +378,53 @@ static void test_hashes(void)
         test_hash(tests+i);
 }
 
+static void test_sha256_blocks(void)
+{
+    static const char msg[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    static const char expected[] = "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1";
+    static const char expected_million[] = "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+    BCRYPT_ALG_HANDLE alg;
+    BCRYPT_HASH_HANDLE hash;
+    UCHAR buf[512], hash_buf[32], *data;
+    ULONG size, total;
+    char str[65];
+    NTSTATUS ret;
+
+    ret = BCryptOpenAlgorithmProvider(&alg, BCRYPT_SHA256_ALGORITHM, MS_PRIMITIVE_PROVIDER, 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    ret = BCryptCreateHash(alg, &hash, buf, sizeof(buf), NULL, 0, 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    ret = BCryptHashData(hash, (UCHAR *)msg, strlen(msg), 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    ret = BCryptFinishHash(hash, hash_buf, sizeof(hash_buf), 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    format_hash(hash_buf, sizeof(hash_buf), str);
+    ok(!strcmp(str, expected), "got %s\n", str);
+    BCryptDestroyHash(hash);
+
+    /* one million 'a', fed in chunks that are not a multiple of the block size */
+    data = HeapAlloc(GetProcessHeap(), 0, 4099);
+    memset(data, 'a', 4099);
+    ret = BCryptCreateHash(alg, &hash, buf, sizeof(buf), NULL, 0, 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    for (total = 0; total < 1000000; total += size)
+    {
+        size = min(4099, 1000000 - total);
+        ret = BCryptHashData(hash, data, size, 0);
+        ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    }
+    ret = BCryptFinishHash(hash, hash_buf, sizeof(hash_buf), 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    format_hash(hash_buf, sizeof(hash_buf), str);
+    ok(!strcmp(str, expected_million), "got %s\n", str);
+    BCryptDestroyHash(hash);
+    HeapFree(GetProcessHeap(), 0, data);
+
+    ret = BCryptCloseAlgorithmProvider(alg, 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+}
+
 static void test_BcryptHash(void)
 {
     static const char expected[] =
@@ -463,9 +510,12 @@ static const struct
 
 static void test_BcryptDeriveKeyPBKDF2(void)
 {
+    static const char dk_sha256[] =
+        "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+        "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783";
     BCRYPT_ALG_HANDLE alg;
-    UCHAR buf[25];
-    char str[51];
+    UCHAR buf[25], buf_sha256[64];
+    char str[51], str_sha256[129];
     NTSTATUS ret;
     ULONG i;
 
@@ -494,6 +544,20 @@ static void test_BcryptDeriveKeyPBKDF2(void)
 
     ret = BCryptCloseAlgorithmProvider(alg, 0);
     ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    /* derived key spanning several hash blocks, test vector from RFC 7914 */
+    ret = BCryptOpenAlgorithmProvider(&alg, BCRYPT_SHA256_ALGORITHM, MS_PRIMITIVE_PROVIDER,
+                                       BCRYPT_ALG_HANDLE_HMAC_FLAG);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+
+    memset(buf_sha256, 0, sizeof(buf_sha256));
+    ret = BCryptDeriveKeyPBKDF2(alg, (UCHAR *)"passwd", 6, salt, 4, 1, buf_sha256, sizeof(buf_sha256), 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
+    format_hash(buf_sha256, sizeof(buf_sha256), str_sha256);
+    ok(!strcmp(str_sha256, dk_sha256), "got %s\n", str_sha256);
+
+    ret = BCryptCloseAlgorithmProvider(alg, 0);
+    ok(ret == STATUS_SUCCESS, "got %08x\n", ret);
 }
 
 static void test_rng(void)
@@ -2967,6 +3031,7 @@ START_TEST(bcrypt)
     test_BCryptGenRandom();
     test_BCryptGetFipsAlgorithmMode();
     test_hashes();
+    test_sha256_blocks();
     test_BcryptHash();
     test_BcryptDeriveKeyPBKDF2();
     test_rng();
@@ -672,6 +672,7 @@ BOOL WINAPI SymSetScopeFromAddr(HANDLE hProcess, ULONG64 addr)
 
     if (!module_init_pair(&pair, hProcess, addr)) return FALSE;
     pair.pcs->localscope_pc = addr;
+    module_request_addr(pair.effective, addr);
     if ((sym = symt_find_nearest(pair.effective, addr)) != NULL && sym->symt.tag == SymTagFunction)
         pair.pcs->localscope_symt = &sym->symt;
     else
@@ -420,6 +420,10 @@ struct module_format
                                                const struct module_format* modfmt,
                                                const struct symt_function* func,
                                                struct location* loc);
+    /* for formats loading their debug information on demand (can be NULL) */
+    void                        (*request_addr)(struct module_format* modfmt, DWORD_PTR addr);
+    void                        (*request_name)(struct module_format* modfmt, const char* name);
+    void                        (*request_all)(struct module_format* modfmt);
     union
     {
         struct elf_module_info*         elf_info;
@@ -695,6 +699,7 @@ extern DWORD calc_crc32(HANDLE handle) DECLSPEC_HIDDEN;
 extern BOOL         elf_read_wine_loader_dbg_info(struct process* pcs, ULONG_PTR addr) DECLSPEC_HIDDEN;
 struct elf_thunk_area;
 extern int          elf_is_in_thunk_area(ULONG_PTR addr, const struct elf_thunk_area* thunks) DECLSPEC_HIDDEN;
+extern struct elf_thunk_area* elf_copy_thunk_area(const struct elf_thunk_area* thunks) DECLSPEC_HIDDEN;
 
 /* macho_module.c */
 extern BOOL         macho_read_wine_loader_dbg_info(struct process* pcs, ULONG_PTR addr) DECLSPEC_HIDDEN;
@@ -722,6 +727,9 @@ extern struct module*
                     module_is_already_loaded(const struct process* pcs,
                                              const WCHAR* imgname) DECLSPEC_HIDDEN;
 extern BOOL         module_get_debug(struct module_pair*) DECLSPEC_HIDDEN;
+extern void         module_request_addr(struct module* module, DWORD_PTR addr) DECLSPEC_HIDDEN;
+extern void         module_request_name(struct module* module, const char* name) DECLSPEC_HIDDEN;
+extern void         module_request_all(struct module* module) DECLSPEC_HIDDEN;
 extern struct module*
                     module_new(struct process* pcs, const WCHAR* name,
                                enum module_type type, BOOL virtual,
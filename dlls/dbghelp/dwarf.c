@@ -154,7 +154,7 @@ typedef struct dwarf2_section_s
     DWORD_PTR                   rva;
 } dwarf2_section_t;
 
-enum dwarf2_sections {section_debug, section_string, section_abbrev, section_line, section_ranges, section_max};
+enum dwarf2_sections {section_debug, section_string, section_abbrev, section_line, section_ranges, section_aranges, section_max};
 
 typedef struct dwarf2_traverse_context_s
 {
@@ -215,12 +215,28 @@ typedef struct dwarf2_parse_context_s
     struct sparse_array         abbrev_table;
     struct sparse_array         debug_info_table;
     ULONG_PTR                   ref_offset;
+    ULONG_PTR                   abbrev_offset;
     char*                       cpp_name;
     dwarf2_cuhead_t             head;
     enum unit_status            status;
     dwarf2_traverse_context_t   traverse_DIE;
 } dwarf2_parse_context_t;
 
+/* address range covered by a compilation unit (from .debug_aranges or the CU's DIE) */
+struct dwarf2_unit_range
+{
+    ULONG_PTR                   low;
+    ULONG_PTR                   high;
+    unsigned                    unit;
+};
+
+/* hash of a (unqualified) name defined at the top level of a compilation unit */
+struct dwarf2_unit_name
+{
+    unsigned                    hash;
+    unsigned                    unit;
+};
+
 /* stored in the dbghelp's module internal structure for later reuse */
 struct dwarf2_module_info_s
 {
@@ -230,6 +246,17 @@ struct dwarf2_module_info_s
     dwarf2_section_t            debug_frame;
     dwarf2_section_t            eh_frame;
     unsigned char               word_size;
+    /* compilation units are only loaded when an address or a name inside them is requested */
+    BOOL                        all_loaded;
+    dwarf2_section_t            sections[section_max];
+    dwarf2_parse_module_context_t module_ctx;
+    struct elf_thunk_area*      thunks;
+    struct dwarf2_unit_range*   unit_ranges;        /* sorted by low address */
+    unsigned                    num_unit_ranges;
+    BOOL                        ranges_indexed;
+    struct dwarf2_unit_name*    unit_names;         /* sorted by hash */
+    unsigned                    num_unit_names;
+    BOOL                        names_indexed;
 };
 
 #define loc_dwarf2_location_list        (loc_user + 0)
@@ -503,7 +530,7 @@ static void dwarf2_parse_abbrev_set(dwarf2_traverse_context_t* abbrev_ctx,
     TRACE("found %u entries\n", sparse_array_length(abbrev_table));
 }
 
-static void dwarf2_swallow_attribute(dwarf2_traverse_context_t* ctx,
+static BOOL dwarf2_swallow_attribute(dwarf2_traverse_context_t* ctx,
                                      const dwarf2_cuhead_t* head,
                                      const dwarf2_abbrev_entry_attr_t* abbrev_attr)
 {
@@ -540,9 +567,10 @@ static void dwarf2_swallow_attribute(dwarf2_traverse_context_t* ctx,
     case DW_FORM_strp:   step = head->offset_size; break;
     default:
         FIXME("Unhandled attribute form %lx\n", abbrev_attr->form);
-        return;
+        return FALSE;
     }
     ctx->data += step;
+    return TRUE;
 }
 
 static BOOL dwarf2_fill_attr(const dwarf2_parse_context_t* ctx,
@@ -2831,10 +2859,20 @@ static dwarf2_parse_context_t* dwarf2_locate_cu(dwarf2_parse_module_context_t* m
     return NULL;
 }
 
+static void dwarf2_parse_unit_abbrev_set(const dwarf2_parse_context_t* ctx,
+                                         struct sparse_array* abbrev_table,
+                                         struct pool* pool)
+{
+    dwarf2_traverse_context_t abbrev_ctx;
+
+    abbrev_ctx.data = ctx->module_ctx->sections[section_abbrev].address + ctx->abbrev_offset;
+    abbrev_ctx.end_data = ctx->module_ctx->sections[section_abbrev].address + ctx->module_ctx->sections[section_abbrev].size;
+    dwarf2_parse_abbrev_set(&abbrev_ctx, abbrev_table, pool);
+}
+
 static BOOL dwarf2_parse_compilation_unit_head(dwarf2_parse_context_t* ctx,
                                                dwarf2_traverse_context_t* mod_ctx)
 {
-    dwarf2_traverse_context_t abbrev_ctx;
     const unsigned char* comp_unit_start = mod_ctx->data;
     ULONG_PTR cu_length;
     ULONG_PTR cu_abbrev_offset;
@@ -2849,6 +2887,8 @@ static BOOL dwarf2_parse_compilation_unit_head(dwarf2_parse_context_t* ctx,
     ctx->head.version = dwarf2_parse_u2(&ctx->traverse_DIE);
     cu_abbrev_offset = dwarf2_parse_offset(&ctx->traverse_DIE, ctx->head.offset_size);
     ctx->head.word_size = dwarf2_parse_byte(&ctx->traverse_DIE);
+    ctx->section = section_debug;
+    ctx->ref_offset = comp_unit_start - ctx->module_ctx->sections[section_debug].address;
     ctx->status = UNIT_ERROR;
 
     TRACE("Compilation Unit Header found at 0x%x:\n",
@@ -2875,17 +2915,10 @@ static BOOL dwarf2_parse_compilation_unit_head(dwarf2_parse_context_t* ctx,
         return FALSE;
     }
 
-    pool_init(&ctx->pool, 65536);
-    ctx->section = section_debug;
-    ctx->ref_offset = comp_unit_start - ctx->module_ctx->sections[section_debug].address;
+    ctx->abbrev_offset = cu_abbrev_offset;
     ctx->cpp_name = NULL;
     ctx->status = UNIT_NOTLOADED;
-
-    abbrev_ctx.data = ctx->module_ctx->sections[section_abbrev].address + cu_abbrev_offset;
-    abbrev_ctx.end_data = ctx->module_ctx->sections[section_abbrev].address + ctx->module_ctx->sections[section_abbrev].size;
-    dwarf2_parse_abbrev_set(&abbrev_ctx, &ctx->abbrev_table, &ctx->pool);
-
-    sparse_array_init(&ctx->debug_info_table, sizeof(dwarf2_debug_info_t), 128);
+    /* pool, abbrev and debug_info tables are only created when the unit is loaded */
     return TRUE;
 }
 
@@ -2907,6 +2940,12 @@ static BOOL dwarf2_parse_compilation_unit(dwarf2_parse_context_t* ctx)
     case UNIT_NOTLOADED: break;
     }
 
+    TRACE("Loading compilation unit at 0x%lx in %s\n",
+          ctx->ref_offset, debugstr_w(ctx->module_ctx->module->modulename));
+    pool_init(&ctx->pool, 65536);
+    dwarf2_parse_unit_abbrev_set(ctx, &ctx->abbrev_table, &ctx->pool);
+    sparse_array_init(&ctx->debug_info_table, sizeof(dwarf2_debug_info_t), 128);
+
     ctx->status = UNIT_BEINGLOADED;
     if (dwarf2_read_one_debug_info(ctx, &cu_ctx, NULL, &di))
     {
@@ -4046,20 +4085,11 @@ static inline void dwarf2_fini_section(dwarf2_section_t* section)
         HeapFree(GetProcessHeap(), 0, (void*)section->address);
 }
 
-static void dwarf2_module_remove(struct process* pcs, struct module_format* modfmt)
-{
-    dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_loc);
-    dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_frame);
-    free(modfmt->u.dwarf2_info->cuheads);
-    HeapFree(GetProcessHeap(), 0, modfmt);
-}
-
 static BOOL dwarf2_load_CU_module(dwarf2_parse_module_context_t* module_ctx, struct module* module,
                                   dwarf2_section_t* sections, ULONG_PTR load_offset,
-                                  const struct elf_thunk_area* thunks, BOOL is_dwz)
+                                  const struct elf_thunk_area* thunks)
 {
     dwarf2_traverse_context_t   mod_ctx;
-    unsigned i;
 
     module_ctx->sections = sections;
     module_ctx->module = module;
@@ -4082,14 +4112,6 @@ static BOOL dwarf2_load_CU_module(dwarf2_parse_module_context_t* module_ctx, str
         dwarf2_parse_compilation_unit_head(unit_ctx, &mod_ctx);
     }
 
-    /* phase2: load content of all CU
-     * If this is a DWZ alternate module, don't load all debug_info at once
-     * wait for main module to ask for them (it's likely it won't need them all)
-     * Doing this can lead to a huge performance improvement.
-     */
-    if (!is_dwz)
-        for (i = 0; i < module_ctx->unit_contexts.num_elts; ++i)
-            dwarf2_parse_compilation_unit((dwarf2_parse_context_t*)vector_at(&module_ctx->unit_contexts, i));
 
     return TRUE;
 }
@@ -4116,7 +4138,7 @@ static dwarf2_dwz_alternate_t* dwarf2_load_dwz(struct image_file_map* fmap, stru
     dwarf2_init_section(&dwz->sections[section_ranges], fmap_dwz, ".debug_ranges", ".zdebug_ranges", &dwz->sectmap[section_ranges]);
 
     dwz->module_ctx.dwz = NULL;
-    dwarf2_load_CU_module(&dwz->module_ctx, module, dwz->sections, 0/*FIXME*/, NULL, TRUE);
+    dwarf2_load_CU_module(&dwz->module_ctx, module, dwz->sections, 0/*FIXME*/, NULL);
     return dwz;
 }
 
@@ -4144,23 +4166,506 @@ static BOOL dwarf2_unload_CU_module(dwarf2_parse_module_context_t* module_ctx)
     for (i = 0; i < module_ctx->unit_contexts.num_elts; ++i)
     {
         dwarf2_parse_context_t* unit = vector_at(&module_ctx->unit_contexts, i);
-        if (unit->status != UNIT_ERROR)
+        if (unit->status != UNIT_ERROR && unit->status != UNIT_NOTLOADED)
             pool_destroy(&unit->pool);
     }
     dwarf2_unload_dwz(module_ctx->dwz);
     return TRUE;
 }
 
+/******************************************************************
+ *		dwarf2_release_units
+ *
+ * Once all the compilation units have been loaded, the parsing contexts
+ * and the lookup indexes are no longer needed.
+ */
+static void dwarf2_release_units(struct dwarf2_module_info_s* info)
+{
+    unsigned i;
+
+    dwarf2_unload_CU_module(&info->module_ctx);
+    for (i = 0; i < section_max; i++)
+        dwarf2_fini_section(&info->sections[i]);
+    free(info->unit_ranges);
+    info->unit_ranges = NULL;
+    info->num_unit_ranges = 0;
+    free(info->unit_names);
+    info->unit_names = NULL;
+    info->num_unit_names = 0;
+    free(info->thunks);
+    info->thunks = NULL;
+    info->all_loaded = TRUE;
+}
+
+static void dwarf2_module_remove(struct process* pcs, struct module_format* modfmt)
+{
+    if (!modfmt->u.dwarf2_info->all_loaded)
+        dwarf2_release_units(modfmt->u.dwarf2_info);
+    dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_loc);
+    dwarf2_fini_section(&modfmt->u.dwarf2_info->debug_frame);
+    free(modfmt->u.dwarf2_info->cuheads);
+    HeapFree(GetProcessHeap(), 0, modfmt);
+}
+
+/* returns the index of the unit starting at offset in .debug_info (or -1 if none) */
+static unsigned dwarf2_find_unit_by_offset(const dwarf2_parse_module_context_t* module_ctx, ULONG_PTR offset)
+{
+    unsigned low = 0, high = vector_length(&module_ctx->unit_contexts), mid;
+    ULONG_PTR ref;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        ref = ((dwarf2_parse_context_t*)vector_at(&module_ctx->unit_contexts, mid))->ref_offset;
+        if (ref == offset) return mid;
+        if (ref < offset) low = mid + 1;
+        else high = mid;
+    }
+    return ~0u;
+}
+
+static BOOL dwarf2_add_unit_range(struct dwarf2_module_info_s* info, unsigned* alloc,
+                                  ULONG_PTR low, ULONG_PTR high, unsigned unit)
+{
+    if (low >= high) return TRUE;
+    if (info->num_unit_ranges >= *alloc)
+    {
+        unsigned new_alloc = *alloc ? *alloc * 2 : 64;
+        struct dwarf2_unit_range* new = realloc(info->unit_ranges, new_alloc * sizeof(*new));
+
+        if (!new) return FALSE;
+        info->unit_ranges = new;
+        *alloc = new_alloc;
+    }
+    info->unit_ranges[info->num_unit_ranges].low  = info->module_ctx.load_offset + low;
+    info->unit_ranges[info->num_unit_ranges].high = info->module_ctx.load_offset + high;
+    info->unit_ranges[info->num_unit_ranges].unit = unit;
+    info->num_unit_ranges++;
+    return TRUE;
+}
+
+/******************************************************************
+ *		dwarf2_index_unit_die_ranges
+ *
+ * Gets the address ranges of a (not loaded yet) compilation unit from the
+ * attributes of its top level DIE.
+ */
+static BOOL dwarf2_index_unit_die_ranges(struct dwarf2_module_info_s* info, unsigned* alloc, unsigned unit)
+{
+    dwarf2_parse_context_t*     ctx = vector_at(&info->module_ctx.unit_contexts, unit);
+    dwarf2_traverse_context_t   traverse = ctx->traverse_DIE;
+    const dwarf2_abbrev_entry_t*abbrev;
+    dwarf2_abbrev_entry_attr_t* attr;
+    struct sparse_array         abbrev_table;
+    struct pool                 pool;
+    struct attribute            low_pc, high_pc, range;
+    BOOL                        has_low_pc = FALSE, has_high_pc = FALSE, has_range = FALSE;
+    BOOL                        ret = FALSE;
+
+    pool_init(&pool, 65536);
+    dwarf2_parse_unit_abbrev_set(ctx, &abbrev_table, &pool);
+    if ((abbrev = dwarf2_abbrev_table_find_entry(&abbrev_table, dwarf2_leb128_as_unsigned(&traverse))))
+    {
+        for (attr = abbrev->attrs; attr; attr = attr->next)
+        {
+            switch (attr->attribute)
+            {
+            case DW_AT_low_pc:  has_low_pc = dwarf2_fill_attr(ctx, attr, traverse.data, &low_pc); break;
+            case DW_AT_high_pc: has_high_pc = dwarf2_fill_attr(ctx, attr, traverse.data, &high_pc); break;
+            case DW_AT_ranges:  has_range = dwarf2_fill_attr(ctx, attr, traverse.data, &range); break;
+            }
+            if (!dwarf2_swallow_attribute(&traverse, &ctx->head, attr)) break;
+        }
+    }
+    if (has_range)
+    {
+        dwarf2_traverse_context_t   range_traverse;
+        ULONG_PTR                   base = has_low_pc ? low_pc.u.uvalue : 0, low, high;
+
+        range_traverse.data = ctx->module_ctx->sections[section_ranges].address + range.u.uvalue;
+        range_traverse.end_data = ctx->module_ctx->sections[section_ranges].address +
+            ctx->module_ctx->sections[section_ranges].size;
+        while (range_traverse.data + 2 * ctx->head.word_size <= range_traverse.end_data)
+        {
+            low = dwarf2_parse_addr_head(&range_traverse, &ctx->head);
+            high = dwarf2_parse_addr_head(&range_traverse, &ctx->head);
+            if (low == 0 && high == 0) break;
+            /* base address selection entry */
+            if (low == (ctx->head.word_size == 8 ? (~(DWORD64)0u) : (DWORD64)(~0u)))
+                base = high;
+            else if (dwarf2_add_unit_range(info, alloc, base + low, base + high, unit))
+                ret = TRUE;
+        }
+    }
+    else if (has_low_pc && has_high_pc)
+    {
+        /* From dwarf4 on, when FORM's class is constant, high_pc is an offset from low_pc */
+        if (ctx->head.version >= 4 && high_pc.form != DW_FORM_addr)
+            high_pc.u.uvalue += low_pc.u.uvalue;
+        ret = dwarf2_add_unit_range(info, alloc, low_pc.u.uvalue, high_pc.u.uvalue, unit);
+    }
+    pool_destroy(&pool);
+    return ret;
+}
+
+static int __cdecl dwarf2_cmp_unit_range(const void* p1, const void* p2)
+{
+    const struct dwarf2_unit_range* r1 = p1;
+    const struct dwarf2_unit_range* r2 = p2;
+
+    if (r1->low < r2->low) return -1;
+    if (r1->low > r2->low) return 1;
+    return 0;
+}
+
+/******************************************************************
+ *		dwarf2_index_unit_ranges
+ *
+ * Builds the address => compilation unit index, from the .debug_aranges
+ * section, and from the top level DIE for the units not described there.
+ */
+static void dwarf2_index_unit_ranges(struct dwarf2_module_info_s* info)
+{
+    dwarf2_parse_module_context_t* module_ctx = &info->module_ctx;
+    const dwarf2_section_t*     aranges = &module_ctx->sections[section_aranges];
+    dwarf2_traverse_context_t   traverse, set;
+    const unsigned char*        set_start;
+    unsigned char               offset_size, address_size, segment_size;
+    unsigned short              version;
+    ULONG_PTR                   length, unit_offset, start, size;
+    unsigned                    alloc = 0, num_units = vector_length(&module_ctx->unit_contexts), i, unit;
+    BOOL*                       covered;
+
+    info->ranges_indexed = TRUE;
+    if (!(covered = calloc(num_units + 1, sizeof(BOOL)))) return;
+
+    traverse.data = aranges->address;
+    traverse.end_data = aranges->address + aranges->size;
+    while (traverse.data && traverse.data != IMAGE_NO_MAP && traverse.data < traverse.end_data)
+    {
+        set_start = traverse.data;
+        length = dwarf2_parse_3264(&traverse, &offset_size);
+        set.data = traverse.data;
+        set.end_data = traverse.data + length;
+        if (set.end_data > traverse.end_data) break;
+        traverse.data = set.end_data;
+
+        version = dwarf2_parse_u2(&set);
+        unit_offset = dwarf2_parse_offset(&set, offset_size);
+        address_size = dwarf2_parse_byte(&set);
+        segment_size = dwarf2_parse_byte(&set);
+        if (version != 2 || segment_size || (address_size != 4 && address_size != 8) ||
+            (unit = dwarf2_find_unit_by_offset(module_ctx, unit_offset)) == ~0u)
+        {
+            WARN("Skipping aranges set for unit 0x%lx (version %u, address size %u, segment size %u)\n",
+                 unit_offset, version, address_size, segment_size);
+            continue;
+        }
+        /* tuples are aligned on twice the address size, from the start of the set */
+        set.data = set_start + ((set.data - set_start + 2 * address_size - 1) & ~(2 * address_size - 1));
+        while (set.data + 2 * address_size <= set.end_data)
+        {
+            start = dwarf2_get_addr(set.data, address_size);
+            size = dwarf2_get_addr(set.data + address_size, address_size);
+            set.data += 2 * address_size;
+            if (!start && !size) break;
+            dwarf2_add_unit_range(info, &alloc, start, start + size, unit);
+        }
+        covered[unit] = TRUE;
+    }
+
+    for (i = 0; i < num_units; i++)
+    {
+        dwarf2_parse_context_t* ctx = vector_at(&module_ctx->unit_contexts, i);
+        if (!covered[i] && ctx->status == UNIT_NOTLOADED)
+            dwarf2_index_unit_die_ranges(info, &alloc, i);
+    }
+    free(covered);
+
+    qsort(info->unit_ranges, info->num_unit_ranges, sizeof(info->unit_ranges[0]), dwarf2_cmp_unit_range);
+    TRACE("%u address ranges for %u units in %s\n",
+          info->num_unit_ranges, num_units, debugstr_w(module_ctx->module->modulename));
+}
+
+/* only the last component of a qualified (C++) name is stored in DW_AT_name */
+static unsigned dwarf2_hash_name(const char* name)
+{
+    const char* ptr;
+    unsigned hash = 0;
+    int depth = 0;
+
+    for (ptr = name; *ptr; ptr++)
+    {
+        switch (*ptr)
+        {
+        case '<': case '(': depth++; break;
+        case '>': case ')': if (depth) depth--; break;
+        case ':':
+            if (!depth && ptr[1] == ':')
+            {
+                name = ptr + 2;
+                ptr++;
+            }
+            break;
+        }
+    }
+    while (*name) hash = hash * 31 + (unsigned char)*name++;
+    return hash;
+}
+
+static BOOL dwarf2_add_unit_name(struct dwarf2_module_info_s* info, unsigned* alloc,
+                                 const char* name, unsigned unit)
+{
+    if (info->num_unit_names >= *alloc)
+    {
+        unsigned new_alloc = *alloc ? *alloc * 2 : 256;
+        struct dwarf2_unit_name* new = realloc(info->unit_names, new_alloc * sizeof(*new));
+
+        if (!new) return FALSE;
+        info->unit_names = new;
+        *alloc = new_alloc;
+    }
+    info->unit_names[info->num_unit_names].hash = dwarf2_hash_name(name);
+    info->unit_names[info->num_unit_names].unit = unit;
+    info->num_unit_names++;
+    return TRUE;
+}
+
+/******************************************************************
+ *		dwarf2_skim_one_debug_info
+ *
+ * Skips over one debug info entry (but not its children), only returning
+ * its abbrev, its name and the reference of its origin (specification or
+ * abstract origin) if any.
+ * *pabbrev is set to NULL at the end of a list of siblings.
+ */
+static BOOL dwarf2_skim_one_debug_info(const dwarf2_parse_context_t* ctx,
+                                       const struct sparse_array* abbrev_table,
+                                       dwarf2_traverse_context_t* traverse,
+                                       const dwarf2_abbrev_entry_t** pabbrev,
+                                       const char** name, ULONG_PTR* origin)
+{
+    const dwarf2_abbrev_entry_t*abbrev;
+    dwarf2_abbrev_entry_attr_t* attr;
+    struct attribute            value;
+    ULONG_PTR                   entry_code;
+
+    *pabbrev = NULL;
+    *name = NULL;
+    *origin = 0;
+    if (!(entry_code = dwarf2_leb128_as_unsigned(traverse))) return TRUE;
+    if (!(abbrev = dwarf2_abbrev_table_find_entry(abbrev_table, entry_code))) return FALSE;
+    for (attr = abbrev->attrs; attr; attr = attr->next)
+    {
+        switch (attr->attribute)
+        {
+        case DW_AT_name:
+            if ((attr->form == DW_FORM_string || attr->form == DW_FORM_strp ||
+                 attr->form == DW_FORM_GNU_strp_alt) &&
+                dwarf2_fill_attr(ctx, attr, traverse->data, &value))
+                *name = value.u.string;
+            break;
+        case DW_AT_specification:
+        case DW_AT_abstract_origin:
+            if (attr->form != DW_FORM_GNU_ref_alt && attr->form != DW_FORM_ref8 &&
+                dwarf2_fill_attr(ctx, attr, traverse->data, &value))
+                *origin = value.u.uvalue;
+            break;
+        }
+        if (!dwarf2_swallow_attribute(traverse, &ctx->head, attr)) return FALSE;
+    }
+    *pabbrev = abbrev;
+    return TRUE;
+}
+
+/* get the name of a DIE from its origin(s), as long as they're inside the same unit */
+static const char* dwarf2_get_origin_name(const dwarf2_parse_context_t* ctx,
+                                          const struct sparse_array* abbrev_table,
+                                          ULONG_PTR origin)
+{
+    dwarf2_traverse_context_t   traverse;
+    const dwarf2_abbrev_entry_t*abbrev;
+    const char*                 name;
+    unsigned                    i;
+
+    for (i = 0; i < 4 && origin; i++)
+    {
+        traverse.data = ctx->module_ctx->sections[ctx->section].address + origin;
+        traverse.end_data = ctx->traverse_DIE.end_data;
+        if (traverse.data < ctx->traverse_DIE.data || traverse.data >= traverse.end_data) break;
+        if (!dwarf2_skim_one_debug_info(ctx, abbrev_table, &traverse, &abbrev, &name, &origin) || !abbrev)
+            break;
+        if (name) return name;
+    }
+    return NULL;
+}
+
+#define MAX_INDEXED_DEPTH 32
+
+/******************************************************************
+ *		dwarf2_index_unit_names
+ *
+ * Walks the DIEs of a (not loaded yet) compilation unit, and stores the
+ * names of all the entries defined at the top level of the unit (or inside
+ * namespaces).
+ */
+static BOOL dwarf2_index_unit_names(struct dwarf2_module_info_s* info, unsigned* alloc, unsigned unit)
+{
+    dwarf2_parse_context_t*     ctx = vector_at(&info->module_ctx.unit_contexts, unit);
+    dwarf2_traverse_context_t   traverse = ctx->traverse_DIE;
+    const dwarf2_abbrev_entry_t*abbrev;
+    struct sparse_array         abbrev_table;
+    struct pool                 pool;
+    const char*                 name;
+    ULONG_PTR                   origin;
+    BOOL                        children_indexed[MAX_INDEXED_DEPTH];
+    BOOL                        indexed, ret = TRUE;
+    unsigned                    depth = 0;
+
+    pool_init(&pool, 65536);
+    dwarf2_parse_unit_abbrev_set(ctx, &abbrev_table, &pool);
+    while (traverse.data < traverse.end_data)
+    {
+        if (!dwarf2_skim_one_debug_info(ctx, &abbrev_table, &traverse, &abbrev, &name, &origin))
+        {
+            ret = FALSE;
+            break;
+        }
+        if (!abbrev)
+        {
+            /* end of the children of the entry at depth - 1 */
+            if (!depth || !--depth) break;
+            continue;
+        }
+        indexed = depth && depth <= MAX_INDEXED_DEPTH && children_indexed[depth - 1];
+        if (indexed)
+        {
+            if (!name && origin) name = dwarf2_get_origin_name(ctx, &abbrev_table, origin);
+            if (name && !dwarf2_add_unit_name(info, alloc, name, unit))
+            {
+                ret = FALSE;
+                break;
+            }
+        }
+        if (abbrev->have_child)
+        {
+            if (depth < MAX_INDEXED_DEPTH)
+                children_indexed[depth] = !depth || (indexed && abbrev->tag == DW_TAG_namespace);
+            depth++;
+        }
+        else if (!depth) break;
+    }
+    pool_destroy(&pool);
+    return ret;
+}
+
+static int __cdecl dwarf2_cmp_unit_name(const void* p1, const void* p2)
+{
+    const struct dwarf2_unit_name* n1 = p1;
+    const struct dwarf2_unit_name* n2 = p2;
+
+    if (n1->hash != n2->hash) return n1->hash < n2->hash ? -1 : 1;
+    if (n1->unit != n2->unit) return n1->unit < n2->unit ? -1 : 1;
+    return 0;
+}
+
+/******************************************************************
+ *		dwarf2_index_names
+ *
+ * Builds the name hash => compilation unit index.
+ */
+static void dwarf2_index_names(struct dwarf2_module_info_s* info)
+{
+    unsigned alloc = 0, num_units = vector_length(&info->module_ctx.unit_contexts), i, j;
+
+    info->names_indexed = TRUE;
+    for (i = 0; i < num_units; i++)
+    {
+        dwarf2_parse_context_t* ctx = vector_at(&info->module_ctx.unit_contexts, i);
+
+        if (ctx->status != UNIT_NOTLOADED) continue;
+        if (!dwarf2_index_unit_names(info, &alloc, i))
+        {
+            WARN("Couldn't index names of unit 0x%lx in %s, loading it\n",
+                 ctx->ref_offset, debugstr_w(info->module_ctx.module->modulename));
+            dwarf2_parse_compilation_unit(ctx);
+        }
+    }
+    qsort(info->unit_names, info->num_unit_names, sizeof(info->unit_names[0]), dwarf2_cmp_unit_name);
+    for (i = j = 0; i < info->num_unit_names; i++)
+    {
+        if (!j || dwarf2_cmp_unit_name(&info->unit_names[j - 1], &info->unit_names[i]))
+            info->unit_names[j++] = info->unit_names[i];
+    }
+    info->num_unit_names = j;
+    TRACE("%u names for %u units in %s\n",
+          info->num_unit_names, num_units, debugstr_w(info->module_ctx.module->modulename));
+}
+
+static void dwarf2_module_request_addr(struct module_format* modfmt, DWORD_PTR addr)
+{
+    struct dwarf2_module_info_s* info = modfmt->u.dwarf2_info;
+    unsigned low, high, mid;
+
+    if (info->all_loaded) return;
+    if (!info->ranges_indexed) dwarf2_index_unit_ranges(info);
+
+    /* find the last range starting at or before addr */
+    low = 0;
+    high = info->num_unit_ranges;
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (info->unit_ranges[mid].low <= addr) low = mid + 1;
+        else high = mid;
+    }
+    if (low && addr < info->unit_ranges[low - 1].high)
+        dwarf2_parse_compilation_unit(vector_at(&info->module_ctx.unit_contexts, info->unit_ranges[low - 1].unit));
+}
+
+static void dwarf2_module_request_name(struct module_format* modfmt, const char* name)
+{
+    struct dwarf2_module_info_s* info = modfmt->u.dwarf2_info;
+    unsigned low, high, mid, hash;
+
+    if (info->all_loaded || !name) return;
+    if (!info->names_indexed) dwarf2_index_names(info);
+
+    hash = dwarf2_hash_name(name);
+    low = 0;
+    high = info->num_unit_names;
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (info->unit_names[mid].hash < hash) low = mid + 1;
+        else high = mid;
+    }
+    for (; low < info->num_unit_names && info->unit_names[low].hash == hash; low++)
+        dwarf2_parse_compilation_unit(vector_at(&info->module_ctx.unit_contexts, info->unit_names[low].unit));
+}
+
+static void dwarf2_module_request_all(struct module_format* modfmt)
+{
+    struct dwarf2_module_info_s* info = modfmt->u.dwarf2_info;
+    unsigned i;
+
+    if (info->all_loaded) return;
+    for (i = 0; i < vector_length(&info->module_ctx.unit_contexts); i++)
+        dwarf2_parse_compilation_unit(vector_at(&info->module_ctx.unit_contexts, i));
+    dwarf2_release_units(info);
+}
+
 BOOL dwarf2_parse(struct module* module, ULONG_PTR load_offset,
                   const struct elf_thunk_area* thunks,
                   struct image_file_map* fmap)
 {
     dwarf2_section_t    eh_frame, section[section_max];
     struct image_section_map    debug_sect, debug_str_sect, debug_abbrev_sect,
-                                debug_line_sect, debug_ranges_sect, eh_frame_sect;
-    BOOL                ret = TRUE;
+                                debug_line_sect, debug_ranges_sect, debug_aranges_sect,
+                                eh_frame_sect;
+    BOOL                ret = TRUE, owned = FALSE, lazy;
     struct module_format* dwarf2_modfmt;
-    dwarf2_parse_module_context_t module_ctx;
+    struct dwarf2_module_info_s* info;
 
     if (!dwarf2_init_section(&eh_frame,                fmap, ".eh_frame",     NULL,             &eh_frame_sect))
         /* lld produces .eh_fram to avoid generating a long name */
@@ -4170,6 +4675,12 @@ BOOL dwarf2_parse(struct module* module, ULONG_PTR load_offset,
     dwarf2_init_section(&section[section_string], fmap, ".debug_str",    ".zdebug_str",    &debug_str_sect);
     dwarf2_init_section(&section[section_line],   fmap, ".debug_line",   ".zdebug_line",   &debug_line_sect);
     dwarf2_init_section(&section[section_ranges], fmap, ".debug_ranges", ".zdebug_ranges", &debug_ranges_sect);
+    dwarf2_init_section(&section[section_aranges], fmap, ".debug_aranges", ".zdebug_aranges", &debug_aranges_sect);
+
+    /* Mach-O symbol tables are fixed up from the whole Dwarf information
+     * right after it's been parsed, so it can't be loaded on demand.
+     */
+    lazy = fmap->modtype != DMT_MACHO;
 
     /* to do anything useful we need either .eh_frame or .debug_info */
     if ((!eh_frame.address || eh_frame.address == IMAGE_NO_MAP) &&
@@ -4197,51 +4708,87 @@ BOOL dwarf2_parse(struct module* module, ULONG_PTR load_offset,
         ret = FALSE;
         goto leave;
     }
+    info = (struct dwarf2_module_info_s*)(dwarf2_modfmt + 1);
     dwarf2_modfmt->module = module;
     dwarf2_modfmt->remove = dwarf2_module_remove;
     dwarf2_modfmt->loc_compute = dwarf2_location_compute;
-    dwarf2_modfmt->u.dwarf2_info = (struct dwarf2_module_info_s*)(dwarf2_modfmt + 1);
-    dwarf2_modfmt->u.dwarf2_info->word_size = fmap->addr_size / 8; /* set the word_size for eh_frame parsing */
+    dwarf2_modfmt->request_addr = NULL;
+    dwarf2_modfmt->request_name = NULL;
+    dwarf2_modfmt->request_all = NULL;
+    dwarf2_modfmt->u.dwarf2_info = info;
+    info->word_size = fmap->addr_size / 8; /* set the word_size for eh_frame parsing */
     dwarf2_modfmt->module->format_info[DFI_DWARF] = dwarf2_modfmt;
 
     /* As we'll need later some sections' content, we won't unmap these
      * sections upon existing this function
      */
-    dwarf2_init_section(&dwarf2_modfmt->u.dwarf2_info->debug_loc,   fmap, ".debug_loc",   ".zdebug_loc",   NULL);
-    dwarf2_init_section(&dwarf2_modfmt->u.dwarf2_info->debug_frame, fmap, ".debug_frame", ".zdebug_frame", NULL);
-    dwarf2_modfmt->u.dwarf2_info->eh_frame = eh_frame;
-    dwarf2_modfmt->u.dwarf2_info->cuheads = NULL;
-    dwarf2_modfmt->u.dwarf2_info->num_cuheads = 0;
-
-    module_ctx.dwz = dwarf2_load_dwz(fmap, module);
-    dwarf2_load_CU_module(&module_ctx, module, section, load_offset, thunks, FALSE);
+    dwarf2_init_section(&info->debug_loc,   fmap, ".debug_loc",   ".zdebug_loc",   NULL);
+    dwarf2_init_section(&info->debug_frame, fmap, ".debug_frame", ".zdebug_frame", NULL);
+    info->eh_frame = eh_frame;
+    info->cuheads = NULL;
+    info->num_cuheads = 0;
+
+    /* the compilation units are loaded on demand, so the module keeps the
+     * .debug_* sections (and the parsing contexts) until all of them are loaded
+     */
+    memcpy(info->sections, section, sizeof(section));
+    owned = TRUE;
+    info->all_loaded = FALSE;
+    info->thunks = lazy ? elf_copy_thunk_area(thunks) : NULL;
+    info->unit_ranges = NULL;
+    info->num_unit_ranges = 0;
+    info->ranges_indexed = FALSE;
+    info->unit_names = NULL;
+    info->num_unit_names = 0;
+    info->names_indexed = FALSE;
+
+    info->module_ctx.dwz = dwarf2_load_dwz(fmap, module);
+    dwarf2_load_CU_module(&info->module_ctx, module, info->sections, load_offset,
+                          lazy ? info->thunks : thunks);
 
     dwarf2_modfmt->module->module.SymType = SymDia;
     /* hide dwarf versions in CVSig
      * bits 24-31 will be set according to found dwarf version
      * different CU can have different dwarf version, so use a bit per version (version 2 => b24)
      */
-    dwarf2_modfmt->module->module.CVSig = 'D' | ('W' << 8) | ('F' << 16) | ((module_ctx.cu_versions & 0xFF) << 24);
+    dwarf2_modfmt->module->module.CVSig = 'D' | ('W' << 8) | ('F' << 16) | ((info->module_ctx.cu_versions & 0xFF) << 24);
     /* FIXME: we could have a finer grain here */
     dwarf2_modfmt->module->module.GlobalSymbols = TRUE;
     dwarf2_modfmt->module->module.TypeInfo = TRUE;
     dwarf2_modfmt->module->module.SourceIndexed = TRUE;
     dwarf2_modfmt->module->module.Publics = TRUE;
 
-    dwarf2_unload_CU_module(&module_ctx);
+    if (lazy)
+    {
+        dwarf2_modfmt->request_addr = dwarf2_module_request_addr;
+        dwarf2_modfmt->request_name = dwarf2_module_request_name;
+        dwarf2_modfmt->request_all = dwarf2_module_request_all;
+        /* line numbers are only known once a unit is loaded */
+        if (section[section_line].size)
+            dwarf2_modfmt->module->module.LineNumbers = TRUE;
+    }
+    else dwarf2_module_request_all(dwarf2_modfmt);
 leave:
 
-    dwarf2_fini_section(&section[section_debug]);
-    dwarf2_fini_section(&section[section_abbrev]);
-    dwarf2_fini_section(&section[section_string]);
-    dwarf2_fini_section(&section[section_line]);
-    dwarf2_fini_section(&section[section_ranges]);
-
-    image_unmap_section(&debug_sect);
-    image_unmap_section(&debug_abbrev_sect);
-    image_unmap_section(&debug_str_sect);
-    image_unmap_section(&debug_line_sect);
-    image_unmap_section(&debug_ranges_sect);
+    if (!owned)
+    {
+        dwarf2_fini_section(&section[section_debug]);
+        dwarf2_fini_section(&section[section_abbrev]);
+        dwarf2_fini_section(&section[section_string]);
+        dwarf2_fini_section(&section[section_line]);
+        dwarf2_fini_section(&section[section_ranges]);
+        dwarf2_fini_section(&section[section_aranges]);
+    }
+
+    if (!ret || !lazy)
+    {
+        image_unmap_section(&debug_sect);
+        image_unmap_section(&debug_abbrev_sect);
+        image_unmap_section(&debug_str_sect);
+        image_unmap_section(&debug_line_sect);
+        image_unmap_section(&debug_ranges_sect);
+        image_unmap_section(&debug_aranges_sect);
+    }
     if (!ret) image_unmap_section(&eh_frame_sect);
 
     return ret;
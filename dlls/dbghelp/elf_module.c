@@ -627,6 +627,23 @@ int elf_is_in_thunk_area(ULONG_PTR addr,
     return -1;
 }
 
+/******************************************************************
+ *		elf_copy_thunk_area
+ *
+ * Returns a copy (to be released with free()) of a thunk area array.
+ */
+struct elf_thunk_area* elf_copy_thunk_area(const struct elf_thunk_area* thunks)
+{
+    struct elf_thunk_area* copy;
+    unsigned count = 0;
+
+    if (!thunks) return NULL;
+    while (thunks[count].symname) count++;
+    if ((copy = malloc((count + 1) * sizeof(*copy))))
+        memcpy(copy, thunks, (count + 1) * sizeof(*copy));
+    return copy;
+}
+
 /******************************************************************
  *		elf_hash_symtab
  *
@@ -1085,9 +1102,15 @@ static BOOL elf_load_debug_info_from_map(struct module* module,
     }
     if (wcsstr(module->modulename, S_ElfW) || !wcscmp(module->modulename, S_WineLoaderW))
     {
-        /* add the thunks for native libraries */
+        /* add the thunks for native libraries
+         * (this needs all the debug information to be loaded to detect the ELF
+         * symbols without debug information)
+         */
         if (!(dbghelp_options & SYMOPT_PUBLICS_ONLY))
+        {
+            module_request_all(module);
             elf_new_wine_thunks(module, ht_symtab, thunks);
+        }
     }
     /* add all the public symbols from symtab */
     if (elf_new_public_symbols(module, ht_symtab) && !ret) ret = TRUE;
@@ -1252,10 +1275,13 @@ static BOOL elf_load_file_from_fmap(struct process* pcs, const WCHAR* filename,
         elf_info->module->reloc_delta = elf_info->module->module.BaseOfImage - fmap->u.elf.elf_start;
         elf_module_info = (void*)(modfmt + 1);
         elf_info->module->format_info[DFI_ELF] = modfmt;
-        modfmt->module      = elf_info->module;
-        modfmt->remove      = elf_module_remove;
-        modfmt->loc_compute = NULL;
-        modfmt->u.elf_info  = elf_module_info;
+        modfmt->module       = elf_info->module;
+        modfmt->remove       = elf_module_remove;
+        modfmt->loc_compute  = NULL;
+        modfmt->request_addr = NULL;
+        modfmt->request_name = NULL;
+        modfmt->request_all  = NULL;
+        modfmt->u.elf_info   = elf_module_info;
 
         elf_module_info->elf_addr = load_offset;
 
@@ -399,6 +399,245 @@ static void append(struct dump_context* dc, const void* data, unsigned size)
     dc->rva += size;
 }
 
+/* memory ranges are copied into the minidump by chunks of this size; while
+ * one chunk is being written to the file, the next one is read from the process
+ */
+#define DUMP_MEMORY_CHUNK_SIZE  (1024 * 1024)
+
+struct dump_memory_chunk
+{
+    ULONG64                     rva;
+    DWORD                       size;           /* 0 tells the writer thread to exit */
+    HANDLE                      filled;         /* chunk is ready to be written */
+    HANDLE                      empty;          /* chunk can be filled again */
+    char*                       data;
+};
+
+struct dump_memory_writer
+{
+    struct dump_context*        dc;
+    HANDLE                      thread;         /* NULL when writing synchronously */
+    HANDLE                      started;        /* writer thread is running */
+    unsigned                    current;
+    struct dump_memory_chunk    chunks[2];
+};
+
+/* how long to wait for the writer thread to start before writing synchronously,
+ * in case it's blocked in a way memory_writer_can_start() didn't detect
+ */
+#define DUMP_MEMORY_WRITER_START_TIMEOUT        500
+
+enum memory_writer_state
+{
+    WRITER_STARTING,
+    WRITER_RUNNING,
+    WRITER_ABANDONED,
+};
+
+/* passed to the writer thread, which always frees it, as it can start after
+ * the dump has completed
+ */
+struct memory_writer_start
+{
+    LONG                        state;
+    HMODULE                     module;
+    struct dump_memory_writer*  writer;
+};
+
+static void write_memory_chunk(HANDLE hFile, const struct dump_memory_chunk* chunk)
+{
+    LARGE_INTEGER       filepos;
+    DWORD               written;
+
+    filepos.QuadPart = chunk->rva;
+    SetFilePointerEx(hFile, filepos, NULL, FILE_BEGIN);
+    WriteFile(hFile, chunk->data, chunk->size, &written, NULL);
+}
+
+static DWORD WINAPI memory_writer_thread(void* arg)
+{
+    struct memory_writer_start* start = arg;
+    struct dump_memory_writer*  writer = start->writer;
+    HMODULE                     module = start->module;
+    struct dump_memory_chunk*   chunk;
+    unsigned                    i = 0;
+
+    if (InterlockedCompareExchange(&start->state, WRITER_RUNNING, WRITER_STARTING) != WRITER_STARTING)
+        writer = NULL;
+    HeapFree(GetProcessHeap(), 0, start);
+    if (writer)
+    {
+        SetEvent(writer->started);
+        for (;;)
+        {
+            chunk = &writer->chunks[i];
+            WaitForSingleObject(chunk->filled, INFINITE);
+            if (!chunk->size) break;
+            write_memory_chunk(writer->dc->hFile, chunk);
+            SetEvent(chunk->empty);
+            i ^= 1;
+        }
+    }
+    FreeLibraryAndExitThread(module, 0);
+}
+
+/******************************************************************
+ *		memory_writer_can_start
+ *
+ * A new thread can't start while the loader lock is held: either by us
+ * (e.g. dumping from DllMain), or by another thread of the process we're
+ * dumping ourselves (e.g. from an exception filter).
+ */
+static BOOL memory_writer_can_start(const struct dump_context* dc)
+{
+    RTL_CRITICAL_SECTION*       lock = NtCurrentTeb()->Peb->LoaderLock;
+    HANDLE                      owner = *(HANDLE volatile*)&lock->OwningThread;
+
+    if (owner == ULongToHandle(GetCurrentThreadId())) return FALSE;
+    if (owner && dc->pid == GetCurrentProcessId()) return FALSE;
+    return TRUE;
+}
+
+/******************************************************************
+ *		memory_writer_start_thread
+ *
+ * Starts the writer thread. If it doesn't start in time, it's left behind
+ * and the memory is written synchronously.
+ */
+static void memory_writer_start_thread(struct dump_memory_writer* writer)
+{
+    struct memory_writer_start* start;
+
+    if (!memory_writer_can_start(writer->dc))
+    {
+        TRACE("Loader lock is held, writing synchronously\n");
+        return;
+    }
+    if (!(writer->started = CreateEventW(NULL, TRUE, FALSE, NULL))) return;
+    if (!(start = HeapAlloc(GetProcessHeap(), 0, sizeof(*start)))) return;
+    start->state = WRITER_STARTING;
+    start->writer = writer;
+    if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (const WCHAR*)memory_writer_thread,
+                            &start->module))
+    {
+        HeapFree(GetProcessHeap(), 0, start);
+        return;
+    }
+    if (!(writer->thread = CreateThread(NULL, 0, memory_writer_thread, start, 0, NULL)))
+    {
+        WARN("Couldn't create writer thread (%u), writing synchronously\n", GetLastError());
+        FreeLibrary(start->module);
+        HeapFree(GetProcessHeap(), 0, start);
+        return;
+    }
+    if (WaitForSingleObject(writer->started, DUMP_MEMORY_WRITER_START_TIMEOUT) == WAIT_OBJECT_0) return;
+    /* from here on, start belongs to the thread */
+    if (InterlockedCompareExchange(&start->state, WRITER_ABANDONED, WRITER_STARTING) == WRITER_STARTING)
+    {
+        WARN("Writer thread didn't start, writing synchronously\n");
+        CloseHandle(writer->thread);
+        writer->thread = NULL;
+        return;
+    }
+    /* the thread started meanwhile and is about to signal it */
+    WaitForSingleObject(writer->started, INFINITE);
+}
+
+/******************************************************************
+ *		memory_writer_init
+ *
+ * Prepares the copy of memory ranges into the minidump. While the writer
+ * is in use, nothing else must be written to the file.
+ */
+static BOOL memory_writer_init(struct dump_memory_writer* writer, struct dump_context* dc)
+{
+    char*       data;
+    unsigned    i;
+
+    memset(writer, 0, sizeof(*writer));
+    writer->dc = dc;
+    if (!(data = HeapAlloc(GetProcessHeap(), 0, ARRAY_SIZE(writer->chunks) * DUMP_MEMORY_CHUNK_SIZE)))
+        return FALSE;
+    for (i = 0; i < ARRAY_SIZE(writer->chunks); i++)
+    {
+        writer->chunks[i].data = data + i * DUMP_MEMORY_CHUNK_SIZE;
+        writer->chunks[i].filled = CreateEventW(NULL, FALSE, FALSE, NULL);
+        writer->chunks[i].empty = CreateEventW(NULL, FALSE, TRUE, NULL);
+        if (!writer->chunks[i].filled || !writer->chunks[i].empty) return TRUE;
+    }
+    memory_writer_start_thread(writer);
+    return TRUE;
+}
+
+static void memory_writer_fini(struct dump_memory_writer* writer)
+{
+    struct dump_memory_chunk*   chunk;
+    unsigned                    i;
+
+    if (writer->thread)
+    {
+        chunk = &writer->chunks[writer->current];
+        WaitForSingleObject(chunk->empty, INFINITE);
+        chunk->size = 0;
+        SetEvent(chunk->filled);
+        WaitForSingleObject(writer->thread, INFINITE);
+        CloseHandle(writer->thread);
+    }
+    for (i = 0; i < ARRAY_SIZE(writer->chunks); i++)
+    {
+        if (writer->chunks[i].filled) CloseHandle(writer->chunks[i].filled);
+        if (writer->chunks[i].empty) CloseHandle(writer->chunks[i].empty);
+    }
+    if (writer->started) CloseHandle(writer->started);
+    HeapFree(GetProcessHeap(), 0, writer->chunks[0].data);
+}
+
+/******************************************************************
+ *		read_memory_chunk
+ *
+ * Reads a chunk of the debuggee's memory. Parts that cannot be read are
+ * zero-filled, so that the layout of the minidump is kept.
+ */
+static void read_memory_chunk(struct dump_context* dc, ULONG64 base, char* data, DWORD size)
+{
+    DWORD       pos, len;
+
+    if (read_process_memory(dc->process, base, data, size)) return;
+    for (pos = 0; pos < size; pos += len)
+    {
+        len = min(size - pos, 0x1000 - ((base + pos) & 0xfff));
+        if (!read_process_memory(dc->process, base + pos, data + pos, len))
+            memset(data + pos, 0, len);
+    }
+}
+
+/******************************************************************
+ *		memory_writer_add
+ *
+ * Copies a range of the debuggee's memory at a given position in the minidump
+ */
+static void memory_writer_add(struct dump_memory_writer* writer, ULONG64 rva, ULONG64 base, ULONG64 size)
+{
+    struct dump_memory_chunk*   chunk;
+    ULONG64                     pos;
+
+    if (!writer->chunks[0].data) return;
+    for (pos = 0; pos < size; pos += chunk->size)
+    {
+        chunk = &writer->chunks[writer->current];
+        if (writer->thread) WaitForSingleObject(chunk->empty, INFINITE);
+        chunk->rva = rva + pos;
+        chunk->size = min(size - pos, DUMP_MEMORY_CHUNK_SIZE);
+        read_memory_chunk(writer->dc, base + pos, chunk->data, chunk->size);
+        if (writer->thread)
+        {
+            SetEvent(chunk->filled);
+            writer->current ^= 1;
+        }
+        else write_memory_chunk(writer->dc->hFile, chunk);
+    }
+}
+
 /******************************************************************
  *		dump_exception_info
  *
@@ -809,10 +1048,9 @@ static unsigned         dump_memory_info(struct dump_context* dc)
 {
     MINIDUMP_MEMORY_LIST        mdMemList;
     MINIDUMP_MEMORY_DESCRIPTOR  mdMem;
-    DWORD                       written;
-    unsigned                    i, pos, len, sz;
-    RVA                         rva_base;
-    char                        tmp[1024];
+    struct dump_memory_writer   writer;
+    unsigned                    i, sz;
+    RVA                         rva_base, rva_data;
 
     mdMemList.NumberOfMemoryRanges = dc->num_mem;
     append(dc, &mdMemList.NumberOfMemoryRanges,
@@ -822,19 +1060,23 @@ static unsigned         dump_memory_info(struct dump_context* dc)
     dc->rva += sz;
     sz += sizeof(mdMemList.NumberOfMemoryRanges);
 
+    if (!memory_writer_init(&writer, dc))
+        ERR("Couldn't allocate memory, memory ranges won't be dumped\n");
+    rva_data = dc->rva;
+    for (i = 0; i < dc->num_mem; i++)
+    {
+        memory_writer_add(&writer, dc->rva, dc->mem[i].base, dc->mem[i].size);
+        dc->rva += dc->mem[i].size;
+    }
+    memory_writer_fini(&writer);
+
+    /* now that all the memory has been written, fill in the descriptors */
     for (i = 0; i < dc->num_mem; i++)
     {
         mdMem.StartOfMemoryRange = dc->mem[i].base;
-        mdMem.Memory.Rva = dc->rva;
+        mdMem.Memory.Rva = rva_data;
         mdMem.Memory.DataSize = dc->mem[i].size;
-        SetFilePointer(dc->hFile, dc->rva, NULL, FILE_BEGIN);
-        for (pos = 0; pos < dc->mem[i].size; pos += sizeof(tmp))
-        {
-            len = min(dc->mem[i].size - pos, sizeof(tmp));
-            if (read_process_memory(dc->process, dc->mem[i].base + pos, tmp, len))
-                WriteFile(dc->hFile, tmp, len, &written, NULL);
-        }
-        dc->rva += mdMem.Memory.DataSize;
+        rva_data += mdMem.Memory.DataSize;
         writeat(dc, rva_base + i * sizeof(mdMem), &mdMem, sizeof(mdMem));
         if (dc->mem[i].rva)
         {
@@ -854,12 +1096,10 @@ static unsigned         dump_memory64_info(struct dump_context* dc)
 {
     MINIDUMP_MEMORY64_LIST          mdMem64List;
     MINIDUMP_MEMORY_DESCRIPTOR64    mdMem64;
-    DWORD                           written;
-    unsigned                        i, len, sz;
+    struct dump_memory_writer       writer;
+    unsigned                        i, sz;
     RVA                             rva_base;
-    char                            tmp[1024];
-    ULONG64                         pos;
-    LARGE_INTEGER                   filepos;
+    ULONG64                         filepos;
 
     sz = sizeof(mdMem64List.NumberOfMemoryRanges) +
             sizeof(mdMem64List.BaseRva) +
@@ -878,19 +1118,20 @@ static unsigned         dump_memory64_info(struct dump_context* dc)
 
     /* dc->rva is not updated past this point. The end of the dump
      * is just the full memory data. */
-    filepos.QuadPart = dc->rva;
+    if (!memory_writer_init(&writer, dc))
+        ERR("Couldn't allocate memory, memory ranges won't be dumped\n");
+    filepos = dc->rva;
+    for (i = 0; i < dc->num_mem64; i++)
+    {
+        memory_writer_add(&writer, filepos, dc->mem64[i].base, dc->mem64[i].size);
+        filepos += dc->mem64[i].size;
+    }
+    memory_writer_fini(&writer);
+
     for (i = 0; i < dc->num_mem64; i++)
     {
         mdMem64.StartOfMemoryRange = dc->mem64[i].base;
         mdMem64.DataSize = dc->mem64[i].size;
-        SetFilePointerEx(dc->hFile, filepos, NULL, FILE_BEGIN);
-        for (pos = 0; pos < dc->mem64[i].size; pos += sizeof(tmp))
-        {
-            len = min(dc->mem64[i].size - pos, sizeof(tmp));
-            if (read_process_memory(dc->process, dc->mem64[i].base + pos, tmp, len))
-                WriteFile(dc->hFile, tmp, len, &written, NULL);
-        }
-        filepos.QuadPart += mdMem64.DataSize;
         writeat(dc, rva_base + i * sizeof(mdMem64), &mdMem64, sizeof(mdMem64));
     }
 
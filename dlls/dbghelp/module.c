@@ -405,6 +405,60 @@ BOOL module_get_debug(struct module_pair* pair)
     return module_load_debug(pair->effective);
 }
 
+/******************************************************************
+ *		module_request_addr
+ *
+ * Some debug formats only load their information on demand. Ensure that
+ * the information covering a given address is loaded.
+ */
+void module_request_addr(struct module* module, DWORD_PTR addr)
+{
+    struct module_format* modfmt;
+    unsigned i;
+
+    for (i = 0; i < DFI_LAST; i++)
+    {
+        if ((modfmt = module->format_info[i]) && modfmt->request_addr)
+            modfmt->request_addr(modfmt, addr);
+    }
+}
+
+/******************************************************************
+ *		module_request_name
+ *
+ * Ensure that the debug information for symbols or types named 'name'
+ * is loaded.
+ */
+void module_request_name(struct module* module, const char* name)
+{
+    struct module_format* modfmt;
+    unsigned i;
+
+    for (i = 0; i < DFI_LAST; i++)
+    {
+        if ((modfmt = module->format_info[i]) && modfmt->request_name)
+            modfmt->request_name(modfmt, name);
+    }
+}
+
+/******************************************************************
+ *		module_request_all
+ *
+ * Ensure that all the debug information of a module is loaded (needed for
+ * enumerations).
+ */
+void module_request_all(struct module* module)
+{
+    struct module_format* modfmt;
+    unsigned i;
+
+    for (i = 0; i < DFI_LAST; i++)
+    {
+        if ((modfmt = module->format_info[i]) && modfmt->request_all)
+            modfmt->request_all(modfmt);
+    }
+}
+
 /***********************************************************************
  *	module_find_by_addr
  *
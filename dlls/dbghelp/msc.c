@@ -3465,10 +3465,13 @@ static BOOL pdb_process_file(const struct process* pcs,
 
     pdb_module_info = (void*)(modfmt + 1);
     msc_dbg->module->format_info[DFI_PDB] = modfmt;
-    modfmt->module      = msc_dbg->module;
-    modfmt->remove      = pdb_module_remove;
-    modfmt->loc_compute = pdb_location_compute;
-    modfmt->u.pdb_info  = pdb_module_info;
+    modfmt->module       = msc_dbg->module;
+    modfmt->remove       = pdb_module_remove;
+    modfmt->loc_compute  = pdb_location_compute;
+    modfmt->request_addr = NULL;
+    modfmt->request_name = NULL;
+    modfmt->request_all  = NULL;
+    modfmt->u.pdb_info   = pdb_module_info;
 
     memset(cv_zmodules, 0, sizeof(cv_zmodules));
     codeview_init_basic_types(msc_dbg->module);
@@ -822,6 +822,9 @@ struct module* pe_load_native_module(struct process* pcs, const WCHAR* name,
             modfmt->module = module;
             modfmt->remove = pe_module_remove;
             modfmt->loc_compute = NULL;
+            modfmt->request_addr = NULL;
+            modfmt->request_name = NULL;
+            modfmt->request_all = NULL;
             module->format_info[DFI_PE] = modfmt;
             module->reloc_delta = base - PE_FROM_OPTHDR(&modfmt->u.pe_info->fmap, ImageBase);
         }
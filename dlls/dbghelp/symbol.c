@@ -260,9 +260,13 @@ struct symt_public* symt_new_public(struct module* module,
 
     TRACE_(dbghelp_symt)("Adding public symbol %s:%s @%lx\n",
                          debugstr_w(module->modulename), name, address);
-    if ((dbghelp_options & SYMOPT_AUTO_PUBLICS) &&
-        symt_find_nearest(module, address) != NULL)
-        return NULL;
+    if (dbghelp_options & SYMOPT_AUTO_PUBLICS)
+    {
+        /* the symbol could be defined in debug information not loaded yet */
+        module_request_addr(module, address);
+        if (symt_find_nearest(module, address) != NULL)
+            return NULL;
+    }
     if ((sym = pool_alloc(&module->pool, sizeof(*sym))))
     {
         sym->symt.tag      = SymTagPublicSymbol;
@@ -924,6 +928,7 @@ static BOOL symt_enum_module(struct module_pair* pair, const WCHAR* match,
     WCHAR*                      nameW;
     BOOL                        ret;
 
+    module_request_all(pair->effective);
     hash_table_iter_init(&pair->effective->ht_symbols, &hti, NULL);
     while ((ptr = hash_table_iter_up(&hti)))
     {
@@ -1261,7 +1266,10 @@ struct symt* symt_get_upper_inlined(struct symt_inlinesite* inlined)
 /* lookup in module for an inline site (from addr and inline_ctx) */
 struct symt_inlinesite* symt_find_inlined_site(struct module* module, DWORD64 addr, DWORD inline_ctx)
 {
-    struct symt_ht* symt = symt_find_nearest(module, addr);
+    struct symt_ht* symt;
+
+    module_request_addr(module, addr);
+    symt = symt_find_nearest(module, addr);
 
     if (symt_check_tag(&symt->symt, SymTagFunction))
     {
@@ -1283,7 +1291,10 @@ DWORD symt_get_inlinesite_depth(HANDLE hProcess, DWORD64 addr)
 
     if (module_init_pair(&pair, hProcess, addr))
     {
-        struct symt_ht* symt = symt_find_nearest(pair.effective, addr);
+        struct symt_ht* symt;
+
+        module_request_addr(pair.effective, addr);
+        symt = symt_find_nearest(pair.effective, addr);
         if (symt_check_tag(&symt->symt, SymTagFunction))
         {
             struct symt_inlinesite* inlined = symt_find_lowest_inlined((struct symt_function*)symt, addr);
@@ -1517,6 +1528,7 @@ BOOL WINAPI SymFromAddr(HANDLE hProcess, DWORD64 Address,
     struct symt_ht*     sym;
 
     if (!module_init_pair(&pair, hProcess, Address)) return FALSE;
+    module_request_addr(pair.effective, Address);
     if ((sym = symt_find_nearest(pair.effective, Address)) == NULL) return FALSE;
 
     symt_fill_sym_info(&pair, NULL, &sym->symt, Symbol);
@@ -1618,6 +1630,7 @@ static BOOL find_name(struct process* pcs, struct module* module, const char* na
     if (!(pair.requested = module)) return FALSE;
     if (!module_get_debug(&pair)) return FALSE;
 
+    module_request_name(pair.effective, name);
     hash_table_iter_init(&pair.effective->ht_symbols, &hti, name);
     while ((ptr = hash_table_iter_up(&hti)))
     {
@@ -1904,6 +1917,7 @@ static BOOL get_line_from_addr(HANDLE hProcess, DWORD64 addr,
     struct symt_ht*             symt;
 
     if (!module_init_pair(&pair, hProcess, addr)) return FALSE;
+    module_request_addr(pair.effective, addr);
     if ((symt = symt_find_nearest(pair.effective, addr)) == NULL) return FALSE;
 
     if (symt->symt.tag != SymTagFunction && symt->symt.tag != SymTagInlineSite) return FALSE;
@@ -2536,6 +2550,7 @@ BOOL WINAPI SymEnumLines(HANDLE hProcess, ULONG64 base, PCSTR compiland,
     sci.SizeOfStruct = sizeof(sci);
     sci.ModBase      = base;
 
+    module_request_all(pair.effective);
     hash_table_iter_init(&pair.effective->ht_symbols, &hti, NULL);
     while ((ptr = hash_table_iter_up(&hti)))
     {
@@ -19,6 +19,7 @@
 #include "windef.h"
 #include "verrsrc.h"
 #include "dbghelp.h"
+#include "cvconst.h"
 #include "wine/test.h"
 
 #if defined(__i386__) || defined(__x86_64__)
@@ -190,6 +191,131 @@ static void test_search_path(void)
     ok(!strcmp(search_path, "."), "Got search path '%s', expected '.'\n", search_path);
 }
 
+static void test_minidump_memory(void)
+{
+    char path[MAX_PATH], marker[0x3000];
+    MINIDUMP_MEMORY_LIST *mem_list;
+    MINIDUMP_DIRECTORY *dir;
+    HANDLE file, mapping;
+    const char *base;
+    ULONG size, i;
+    BOOL ret, found = FALSE;
+
+    for (i = 0; i < sizeof(marker); i++) marker[i] = i * 7 + (i >> 8);
+
+    GetTempPathA(ARRAY_SIZE(path), path);
+    strcat(path, "dbghelp_test.dmp");
+    file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    ok(file != INVALID_HANDLE_VALUE, "got error %u\n", GetLastError());
+
+    ret = MiniDumpWriteDump(GetCurrentProcess(), GetCurrentProcessId(), file, MiniDumpNormal, NULL, NULL, NULL);
+    ok(ret, "got error %u\n", GetLastError());
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    ok(mapping != NULL, "got error %u\n", GetLastError());
+    base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    ok(base != NULL, "got error %u\n", GetLastError());
+
+    ret = MiniDumpReadDumpStream((void *)base, MemoryListStream, &dir, (void **)&mem_list, &size);
+    ok(ret, "memory list stream not found\n");
+    if (ret)
+    {
+        /* the stack of the current thread is dumped, and so is our marker */
+        for (i = 0; i < mem_list->NumberOfMemoryRanges; i++)
+        {
+            const MINIDUMP_MEMORY_DESCRIPTOR *desc = &mem_list->MemoryRanges[i];
+
+            if ((ULONG_PTR)marker < desc->StartOfMemoryRange ||
+                (ULONG_PTR)marker + sizeof(marker) > desc->StartOfMemoryRange + desc->Memory.DataSize)
+                continue;
+            found = TRUE;
+            ok(!memcmp(base + desc->Memory.Rva + ((ULONG_PTR)marker - desc->StartOfMemoryRange),
+                       marker, sizeof(marker)), "marker wasn't properly dumped\n");
+        }
+        ok(found, "marker wasn't found in the memory list\n");
+    }
+
+    UnmapViewOfFile(base);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    DeleteFileA(path);
+}
+
+struct public_check
+{
+    struct
+    {
+        DWORD64 address;
+        ULONG tag;
+    } syms[4096];
+    unsigned int count;
+};
+
+static BOOL CALLBACK public_check_cb(SYMBOL_INFO *info, ULONG size, void *ctx)
+{
+    struct public_check *check = ctx;
+
+    if (check->count < ARRAY_SIZE(check->syms))
+    {
+        check->syms[check->count].address = info->Address;
+        check->syms[check->count].tag = info->Tag;
+        check->count++;
+    }
+    return TRUE;
+}
+
+static void test_auto_publics(void)
+{
+    struct public_check *check;
+    char path[MAX_PATH];
+    HMODULE module;
+    HANDLE process;
+    DWORD options;
+    DWORD64 base;
+    unsigned int i, j;
+    BOOL ret;
+
+    module = GetModuleHandleA("dbghelp.dll");
+    GetModuleFileNameA(module, path, ARRAY_SIZE(path));
+
+    /* use another handle, so that the module gets loaded with our options */
+    ret = DuplicateHandle(GetCurrentProcess(), GetCurrentProcess(), GetCurrentProcess(), &process,
+                          0, FALSE, DUPLICATE_SAME_ACCESS);
+    ok(ret, "got error %u\n", GetLastError());
+
+    options = SymGetOptions();
+    SymSetOptions((options & ~SYMOPT_DEFERRED_LOADS) | SYMOPT_AUTO_PUBLICS);
+
+    ret = SymInitialize(process, NULL, FALSE);
+    ok(ret, "got error %u\n", GetLastError());
+    base = SymLoadModuleEx(process, NULL, path, NULL, (ULONG_PTR)module, 0, NULL, 0);
+    ok(base == (ULONG_PTR)module, "got %s\n", wine_dbgstr_longlong(base));
+
+    check = HeapAlloc(GetProcessHeap(), 0, sizeof(*check));
+    check->count = 0;
+    ret = SymEnumSymbols(process, base, "*", public_check_cb, check);
+    ok(ret, "got error %u\n", GetLastError());
+
+    /* exported functions described by the debug information don't get another public symbol */
+    for (i = 0; i < check->count; i++)
+    {
+        if (check->syms[i].tag != SymTagPublicSymbol) continue;
+        for (j = 0; j < check->count; j++)
+        {
+            if (check->syms[j].address == check->syms[i].address && check->syms[j].tag == SymTagFunction)
+                break;
+        }
+        ok(j == check->count, "got public and function symbols at %s\n",
+           wine_dbgstr_longlong(check->syms[i].address));
+    }
+
+    HeapFree(GetProcessHeap(), 0, check);
+    ret = SymCleanup(process);
+    ok(ret, "got error %u\n", GetLastError());
+    SymSetOptions(options);
+    CloseHandle(process);
+}
+
 START_TEST(dbghelp)
 {
     BOOL ret;
@@ -203,6 +329,8 @@ START_TEST(dbghelp)
 
     test_stack_walk();
     test_search_path();
+    test_minidump_memory();
+    test_auto_publics();
 
     ret = SymCleanup(GetCurrentProcess());
     ok(ret, "got error %u\n", GetLastError());
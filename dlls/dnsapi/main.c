@@ -91,13 +91,25 @@ DNS_STATUS WINAPI DnsAcquireContextHandle_W( DWORD flags, PVOID cred,
     return ERROR_SUCCESS;
 }
 
+/* the only resolver cache in the process is the one ws2_32 keeps for getaddrinfo() */
+static void flush_addrinfo_cache( const char *name )
+{
+    void (WINAPI *pflush_addrinfo_cache)( const char * );
+    HMODULE module;
+
+    if (!(module = GetModuleHandleW( L"ws2_32.dll" ))) return;
+    if ((pflush_addrinfo_cache = (void *)GetProcAddress( module, "__wine_flush_addrinfo_cache" )))
+        pflush_addrinfo_cache( name );
+}
+
 /******************************************************************************
  * DnsFlushResolverCache               [DNSAPI.@]
  *
  */
 VOID WINAPI DnsFlushResolverCache(void)
 {
-    FIXME(": stub\n");
+    TRACE( "\n" );
+    flush_addrinfo_cache( NULL );
 }
 
 /******************************************************************************
@@ -106,8 +118,9 @@ VOID WINAPI DnsFlushResolverCache(void)
  */
 BOOL WINAPI DnsFlushResolverCacheEntry_A( PCSTR entry )
 {
-    FIXME( "%s: stub\n", debugstr_a(entry) );
+    TRACE( "%s\n", debugstr_a(entry) );
     if (!entry) return FALSE;
+    flush_addrinfo_cache( entry );
     return TRUE;
 }
 
@@ -117,8 +130,13 @@ BOOL WINAPI DnsFlushResolverCacheEntry_A( PCSTR entry )
  */
 BOOL WINAPI DnsFlushResolverCacheEntry_UTF8( PCSTR entry )
 {
-    FIXME( "%s: stub\n", debugstr_a(entry) );
+    char *name;
+
+    TRACE( "%s\n", debugstr_a(entry) );
     if (!entry) return FALSE;
+    if (!(name = strdup_ua( entry ))) return FALSE;
+    flush_addrinfo_cache( name );
+    free( name );
     return TRUE;
 }
 
@@ -128,8 +146,13 @@ BOOL WINAPI DnsFlushResolverCacheEntry_UTF8( PCSTR entry )
  */
 BOOL WINAPI DnsFlushResolverCacheEntry_W( PCWSTR entry )
 {
-    FIXME( "%s: stub\n", debugstr_w(entry) );
+    char *name;
+
+    TRACE( "%s\n", debugstr_w(entry) );
     if (!entry) return FALSE;
+    if (!(name = strdup_wa( entry ))) return FALSE;
+    flush_addrinfo_cache( name );
+    free( name );
     return TRUE;
 }
 
@@ -170,8 +170,8 @@ struct SchedulerVtbl {
     unsigned int (__thiscall *Release)(Scheduler*);
     void (__thiscall *RegisterShutdownEvent)(Scheduler*,HANDLE);
     void (__thiscall *Attach)(Scheduler*);
-    /* CreateScheduleGroup */
-    /* ScheduleTask */
+    void* (__thiscall *CreateScheduleGroup)(Scheduler*);
+    void (__thiscall *ScheduleTask)(Scheduler*,void (__cdecl*)(void*),void*);
 };
 
 static int* (__cdecl *p_errno)(void);
@@ -956,11 +956,24 @@ static void test_ExternalContextBase(void)
     CloseHandle(thread);
 }
 
+static LONG scheduled_tasks;
+static HANDLE scheduled_tasks_done;
+
+static void __cdecl scheduled_task(void *data)
+{
+    LONG *count = data;
+
+    if(InterlockedIncrement(count) == 100)
+        SetEvent(scheduled_tasks_done);
+}
+
 static void test_Scheduler(void)
 {
     Scheduler *scheduler, *current_scheduler;
     SchedulerPolicy policy;
+    HANDLE shutdown;
     unsigned int i;
+    DWORD ret;
 
     call_func1(p_SchedulerPolicy_ctor, &policy);
     scheduler = p_Scheduler_Create(&policy);
@@ -985,7 +998,23 @@ static void test_Scheduler(void)
 
     i = call_func1(scheduler->vtable->GetNumberOfVirtualProcessors, scheduler);
     ok(i == 1, "Scheduler::GetNumberOfVirtualProcessors() = %u\n", i);
+
+    shutdown = CreateEventW(NULL, TRUE, FALSE, NULL);
+    scheduled_tasks_done = CreateEventW(NULL, TRUE, FALSE, NULL);
+    call_func2(scheduler->vtable->RegisterShutdownEvent, scheduler, shutdown);
+
+    scheduled_tasks = 0;
+    for(i=0; i<100; i++)
+        call_func3(scheduler->vtable->ScheduleTask, scheduler, scheduled_task, &scheduled_tasks);
+    ret = WaitForSingleObject(scheduled_tasks_done, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %d\n", ret);
+    ok(scheduled_tasks == 100, "scheduled_tasks = %d\n", scheduled_tasks);
+
     call_func1(scheduler->vtable->Release, scheduler);
+    ret = WaitForSingleObject(shutdown, 5000);
+    ok(ret == WAIT_OBJECT_0, "shutdown event not signaled: %d\n", ret);
+    CloseHandle(scheduled_tasks_done);
+    CloseHandle(shutdown);
     call_func1(p_SchedulerPolicy_dtor, &policy);
 }
 
@@ -89,11 +89,14 @@ struct scheduler_list {
     struct scheduler_list *next;
 };
 
+struct scheduler_worker;
+
 typedef struct {
     Context context;
     struct scheduler_list scheduler;
     unsigned int id;
     union allocator_cache_entry *allocator_cache[8];
+    struct scheduler_worker *worker;
 } ExternalContextBase;
 extern const vtable_ptr ExternalContextBase_vtable;
 static void ExternalContextBase_ctor(ExternalContextBase*);
@@ -125,6 +128,44 @@ typedef struct Scheduler {
         void, (Scheduler*,void (__cdecl*)(void*),void*), (this,proc,data))
 #endif
 
+struct scheduler_task {
+    void (__cdecl *proc)(void*);
+    void *data;
+    Scheduler *scheduler;
+};
+
+/* work-stealing deque, the owning worker uses the tail while other workers steal from the head */
+struct scheduler_vproc {
+    SRWLOCK lock;
+    struct scheduler_task *tasks;
+    unsigned int size;
+    unsigned int head;
+    unsigned int tail;
+};
+
+/* worker threads and task queues, may outlive the scheduler until all workers exit */
+struct scheduler_pool {
+    LONG ref;
+    SRWLOCK lock;
+    CONDITION_VARIABLE cv;
+    unsigned int vproc_count;
+    struct scheduler_vproc *vprocs;
+    LONG pending;
+    unsigned int next_vproc;
+    unsigned int threads;
+    unsigned int idle;
+    unsigned int blocked;
+    BOOL shutdown;
+    int shutdown_count;
+    HANDLE *shutdown_events;
+};
+
+struct scheduler_worker {
+    struct scheduler_pool *pool;
+    Scheduler *scheduler;
+    unsigned int vproc;
+};
+
 typedef struct {
     Scheduler scheduler;
     LONG ref;
@@ -135,6 +176,7 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
+    struct scheduler_pool *pool;
 } ThreadScheduler;
 extern const vtable_ptr ThreadScheduler_vtable;
 
@@ -756,8 +798,8 @@ unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *thi
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetVirtualProcessorId, 4)
 unsigned int __thiscall ExternalContextBase_GetVirtualProcessorId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+    return this->worker ? this->worker->vproc : -1;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetScheduleGroupId, 4)
@@ -1095,16 +1137,267 @@ void __thiscall SchedulerPolicy_dtor(SchedulerPolicy *this)
     operator_delete(this->policy_container);
 }
 
-static void ThreadScheduler_dtor(ThreadScheduler *this)
+#define SCHEDULER_VPROC_INITIAL_SIZE 64
+#define SCHEDULER_IDLE_TIMEOUT 5000
+
+static struct scheduler_pool* scheduler_pool_create(unsigned int vproc_count)
 {
-    int i;
+    struct scheduler_pool *pool = operator_new(sizeof(*pool));
+    unsigned int i;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->ref = 1;
+    InitializeSRWLock(&pool->lock);
+    InitializeConditionVariable(&pool->cv);
+    pool->vproc_count = vproc_count ? vproc_count : 1;
+    pool->vprocs = operator_new(pool->vproc_count * sizeof(*pool->vprocs));
+    for(i=0; i<pool->vproc_count; i++) {
+        InitializeSRWLock(&pool->vprocs[i].lock);
+        pool->vprocs[i].tasks = NULL;
+        pool->vprocs[i].size = pool->vprocs[i].head = pool->vprocs[i].tail = 0;
+    }
+    return pool;
+}
+
+static void scheduler_pool_release(struct scheduler_pool *pool)
+{
+    unsigned int i;
+
+    if(InterlockedDecrement(&pool->ref))
+        return;
+
+    /* the last reference goes away once the scheduler is destroyed and all workers exited */
+    for(i=0; i<pool->shutdown_count; i++)
+        SetEvent(pool->shutdown_events[i]);
+    operator_delete(pool->shutdown_events);
+
+    for(i=0; i<pool->vproc_count; i++)
+        operator_delete(pool->vprocs[i].tasks);
+    operator_delete(pool->vprocs);
+    operator_delete(pool);
+}
+
+static void scheduler_vproc_push(struct scheduler_vproc *vproc, const struct scheduler_task *task)
+{
+    AcquireSRWLockExclusive(&vproc->lock);
+    if(vproc->tail - vproc->head == vproc->size) {
+        unsigned int i, size = vproc->size ? vproc->size * 2 : SCHEDULER_VPROC_INITIAL_SIZE;
+        struct scheduler_task *tasks = operator_new(size * sizeof(*tasks));
+
+        for(i=0; i<vproc->size; i++)
+            tasks[i] = vproc->tasks[(vproc->head + i) & (vproc->size - 1)];
+        operator_delete(vproc->tasks);
+        vproc->tasks = tasks;
+        vproc->tail -= vproc->head;
+        vproc->head = 0;
+        vproc->size = size;
+    }
+    vproc->tasks[vproc->tail++ & (vproc->size - 1)] = *task;
+    ReleaseSRWLockExclusive(&vproc->lock);
+}
+
+static BOOL scheduler_vproc_pop(struct scheduler_vproc *vproc, struct scheduler_task *task, BOOL steal)
+{
+    BOOL ret = FALSE;
+
+    /* avoid taking the lock of empty deques while looking for work */
+    if(*(volatile unsigned int*)&vproc->tail == *(volatile unsigned int*)&vproc->head)
+        return FALSE;
+
+    AcquireSRWLockExclusive(&vproc->lock);
+    if(vproc->tail != vproc->head) {
+        if(steal)
+            *task = vproc->tasks[vproc->head++ & (vproc->size - 1)];
+        else
+            *task = vproc->tasks[--vproc->tail & (vproc->size - 1)];
+        ret = TRUE;
+    }
+    ReleaseSRWLockExclusive(&vproc->lock);
+    return ret;
+}
+
+static DWORD WINAPI scheduler_worker_proc(void*);
+
+/* called with the pool lock held */
+static void scheduler_pool_spawn_worker(struct scheduler_pool *pool, Scheduler *scheduler)
+{
+    struct scheduler_worker *worker;
+    HMODULE module;
+    HANDLE thread;
+
+    if(pool->shutdown || pool->threads - pool->blocked >= pool->vproc_count)
+        return;
+
+    worker = operator_new(sizeof(*worker));
+    worker->pool = pool;
+    worker->scheduler = scheduler;
+    worker->vproc = pool->threads % pool->vproc_count;
+
+    /* keep the module loaded while the worker runs */
+    if(!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                (const WCHAR*)scheduler_worker_proc, &module)) {
+        operator_delete(worker);
+        return;
+    }
+
+    InterlockedIncrement(&pool->ref);
+    thread = CreateThread(NULL, 0, scheduler_worker_proc, worker, 0, NULL);
+    if(!thread) {
+        WARN("failed to create worker thread: %d\n", GetLastError());
+        InterlockedDecrement(&pool->ref);
+        FreeLibrary(module);
+        operator_delete(worker);
+        return;
+    }
+    CloseHandle(thread);
+    pool->threads++;
+}
+
+static void scheduler_pool_push(struct scheduler_pool *pool, Scheduler *scheduler,
+        const struct scheduler_task *task)
+{
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+    unsigned int vproc;
+
+    /* tasks created by a worker go to its own deque, others are spread over all of them */
+    if(context && context->context.vtable == &ExternalContextBase_vtable &&
+            context->worker && context->worker->pool == pool)
+        vproc = context->worker->vproc;
+    else
+        vproc = InterlockedIncrement((LONG*)&pool->next_vproc) % pool->vproc_count;
 
+    scheduler_vproc_push(&pool->vprocs[vproc], task);
+    InterlockedIncrement(&pool->pending);
+
+    AcquireSRWLockExclusive(&pool->lock);
+    if(pool->idle)
+        WakeConditionVariable(&pool->cv);
+    else
+        scheduler_pool_spawn_worker(pool, scheduler);
+    ReleaseSRWLockExclusive(&pool->lock);
+}
+
+static BOOL scheduler_pool_get_task(struct scheduler_pool *pool,
+        unsigned int vproc, struct scheduler_task *task)
+{
+    unsigned int i;
+
+    for(;;) {
+        if(scheduler_vproc_pop(&pool->vprocs[vproc], task, FALSE)) {
+            InterlockedDecrement(&pool->pending);
+            return TRUE;
+        }
+
+        for(i=1; i<pool->vproc_count; i++) {
+            if(scheduler_vproc_pop(&pool->vprocs[(vproc + i) % pool->vproc_count], task, TRUE)) {
+                InterlockedDecrement(&pool->pending);
+                return TRUE;
+            }
+        }
+
+        AcquireSRWLockExclusive(&pool->lock);
+        if(*(volatile LONG*)&pool->pending) {
+            ReleaseSRWLockExclusive(&pool->lock);
+            continue;
+        }
+
+        /* exit when the scheduler is gone, or when oversubscribed after blocking ended */
+        if(pool->shutdown || pool->threads - pool->blocked > pool->vproc_count) {
+            pool->threads--;
+            ReleaseSRWLockExclusive(&pool->lock);
+            return FALSE;
+        }
+
+        pool->idle++;
+        if(!SleepConditionVariableSRW(&pool->cv, &pool->lock, SCHEDULER_IDLE_TIMEOUT, 0) &&
+                !*(volatile LONG*)&pool->pending) {
+            pool->idle--;
+            pool->threads--;
+            ReleaseSRWLockExclusive(&pool->lock);
+            return FALSE;
+        }
+        pool->idle--;
+        ReleaseSRWLockExclusive(&pool->lock);
+    }
+}
+
+static DWORD WINAPI scheduler_worker_proc(void *arg)
+{
+    struct scheduler_worker *worker = arg;
+    struct scheduler_pool *pool = worker->pool;
+    ExternalContextBase *context;
+    struct scheduler_task task;
+    HMODULE module = NULL;
+
+    TRACE("(%p) starting worker on virtual processor %u\n", pool, worker->vproc);
+
+    /* the worker runs on behalf of its scheduler without keeping it alive */
+    context = (ExternalContextBase*)get_current_context();
+    if(context->scheduler.scheduler)
+        call_Scheduler_Release(context->scheduler.scheduler);
+    context->scheduler.scheduler = worker->scheduler;
+    context->worker = worker;
+
+    /* every task holds a reference to the scheduler while it is queued or running */
+    while(scheduler_pool_get_task(pool, worker->vproc, &task)) {
+        task.proc(task.data);
+        call_Scheduler_Release(task.scheduler);
+    }
+
+    context->scheduler.scheduler = NULL;
+    context->worker = NULL;
+    operator_delete(worker);
+
+    TRACE("(%p) worker exiting\n", pool);
+    scheduler_pool_release(pool);
+
+    GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            (const WCHAR*)scheduler_worker_proc, &module);
+    FreeLibraryAndExitThread(module, 0);
+    return 0;
+}
+
+/* Called before a worker blocks in a synchronization primitive, so another worker
+ * can keep the virtual processor busy. */
+static struct scheduler_pool* scheduler_block_begin(void)
+{
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+    struct scheduler_pool *pool;
+
+    if(!context || context->context.vtable != &ExternalContextBase_vtable || !context->worker)
+        return NULL;
+
+    pool = context->worker->pool;
+    AcquireSRWLockExclusive(&pool->lock);
+    pool->blocked++;
+    if(*(volatile LONG*)&pool->pending && !pool->idle)
+        scheduler_pool_spawn_worker(pool, context->worker->scheduler);
+    ReleaseSRWLockExclusive(&pool->lock);
+    return pool;
+}
+
+static void scheduler_block_end(struct scheduler_pool *pool)
+{
+    if(!pool) return;
+
+    AcquireSRWLockExclusive(&pool->lock);
+    pool->blocked--;
+    ReleaseSRWLockExclusive(&pool->lock);
+}
+
+static void ThreadScheduler_dtor(ThreadScheduler *this)
+{
     if(this->ref != 0) WARN("ref = %d\n", this->ref);
     SchedulerPolicy_dtor(&this->policy);
 
-    for(i=0; i<this->shutdown_count; i++)
-        SetEvent(this->shutdown_events[i]);
-    operator_delete(this->shutdown_events);
+    /* shutdown events are signaled once all the workers have exited */
+    AcquireSRWLockExclusive(&this->pool->lock);
+    this->pool->shutdown = TRUE;
+    this->pool->shutdown_count = this->shutdown_count;
+    this->pool->shutdown_events = this->shutdown_events;
+    WakeAllConditionVariable(&this->pool->cv);
+    ReleaseSRWLockExclusive(&this->pool->lock);
+    scheduler_pool_release(this->pool);
 
     this->cs.DebugInfo->Spare[0] = 0;
     DeleteCriticalSection(&this->cs);
@@ -1217,18 +1510,27 @@ DEFINE_THISCALL_WRAPPER(ThreadScheduler_CreateScheduleGroup, 4)
     return NULL;
 }
 
-DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
-void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
-        void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
-{
-    FIXME("(%p %p %p %p) stub\n", this, proc, data, placement);
-}
-
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
 void __thiscall ThreadScheduler_ScheduleTask(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data)
 {
-    FIXME("(%p %p %p) stub\n", this, proc, data);
+    struct scheduler_task task;
+
+    TRACE("(%p %p %p)\n", this, proc, data);
+
+    task.proc = proc;
+    task.data = data;
+    task.scheduler = &this->scheduler;
+    ThreadScheduler_Reference(this);
+    scheduler_pool_push(this->pool, &this->scheduler, &task);
+}
+
+DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
+void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
+        void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
+{
+    FIXME("(%p %p %p %p) placement ignored\n", this, proc, data, placement);
+    ThreadScheduler_ScheduleTask(this, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_IsAvailableLocation, 8)
@@ -1281,6 +1583,8 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
 
     InitializeCriticalSection(&this->cs);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
+
+    this->pool = scheduler_pool_create(this->virt_proc_no);
     return this;
 }
 
@@ -1769,8 +2073,11 @@ static inline void cs_lock(critical_section *cs, cs_queue *q)
     memset(q, 0, sizeof(*q));
     last = InterlockedExchangePointer(&cs->tail, q);
     if(last) {
+        struct scheduler_pool *pool = scheduler_block_begin();
+
         last->next = q;
         NtWaitForKeyedEvent(keyed_event, q, 0, NULL);
+        scheduler_block_end(pool);
     }
 
     cs_set_head(cs, q);
@@ -2113,6 +2420,7 @@ static inline int evt_transition(void **state, void *from, void *to)
 
 static size_t evt_wait(thread_wait *wait, event **events, int count, bool wait_all, unsigned int timeout)
 {
+    struct scheduler_pool *pool;
     int i;
     NTSTATUS status;
     LARGE_INTEGER ntto;
@@ -2141,10 +2449,12 @@ static size_t evt_wait(thread_wait *wait, event **events, int count, bool wait_a
     if(!evt_transition(&wait->signaled, EVT_RUNNING, EVT_WAITING))
         return evt_end_wait(wait, events, count);
 
+    pool = scheduler_block_begin();
     status = NtWaitForKeyedEvent(keyed_event, wait, 0, evt_timeout(&ntto, timeout));
 
     if(status && !evt_transition(&wait->signaled, EVT_WAITING, EVT_RUNNING))
         NtWaitForKeyedEvent(keyed_event, wait, 0, NULL);
+    scheduler_block_end(pool);
 
     return evt_end_wait(wait, events, count);
 }
@@ -83,6 +83,8 @@ typedef struct {
     LONG selectNsStr_len;
     BOOL XPath;
     IUri *uri;
+    struct list xpathCache;
+    unsigned int xpathCache_count;
 } domdoc_properties;
 
 typedef struct ConnectionPoint ConnectionPoint;
@@ -211,6 +213,28 @@ typedef struct _orphan_entry {
     xmlNode * node;
 } orphan_entry;
 
+/* Compiled selection queries, kept per namespace context so that repeated
+ * selectNodes()/selectSingleNode() calls don't parse the same expression again.
+ * Entries are taken out of the list while in use, a compiled expression is
+ * never evaluated by two threads at once. */
+#define XPATH_CACHE_SIZE 32
+
+typedef struct _xpath_cache_entry {
+    struct list entry;
+    BOOL xpath;
+    xmlChar *query;
+    xmlXPathCompExprPtr comp;
+} xpath_cache_entry;
+
+static CRITICAL_SECTION xpath_cache_cs;
+static CRITICAL_SECTION_DEBUG xpath_cache_cs_debug =
+{
+    0, 0, &xpath_cache_cs,
+    { &xpath_cache_cs_debug.ProcessLocksList, &xpath_cache_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": xpath_cache_cs") }
+};
+static CRITICAL_SECTION xpath_cache_cs = { &xpath_cache_cs_debug, -1, 0, 0, 0, 0 };
+
 typedef struct _select_ns_entry {
     struct list entry;
     xmlChar const* prefix;
@@ -266,6 +290,89 @@ static inline void clear_selectNsList(struct list* pNsList)
     list_init(pNsList);
 }
 
+static void free_xpath_cache_entry(xpath_cache_entry *entry)
+{
+    xmlXPathFreeCompExpr(entry->comp);
+    heap_free(entry->query);
+    heap_free(entry);
+}
+
+static void clear_xpath_cache(domdoc_properties *properties)
+{
+    xpath_cache_entry *entry, *entry2;
+    struct list cache;
+
+    list_init(&cache);
+
+    EnterCriticalSection(&xpath_cache_cs);
+    list_move_tail(&cache, &properties->xpathCache);
+    properties->xpathCache_count = 0;
+    LeaveCriticalSection(&xpath_cache_cs);
+
+    LIST_FOR_EACH_ENTRY_SAFE(entry, entry2, &cache, xpath_cache_entry, entry)
+        free_xpath_cache_entry(entry);
+}
+
+/* Returns a cached compiled form of the query, the caller owns it until
+ * it's handed back with xmldoc_put_xpath(). */
+xmlXPathCompExprPtr xmldoc_get_xpath(xmlDocPtr doc, BOOL xpath, const xmlChar *query)
+{
+    domdoc_properties *properties = properties_from_xmlDocPtr(doc);
+    xpath_cache_entry *entry, *found = NULL;
+    xmlXPathCompExprPtr comp;
+
+    EnterCriticalSection(&xpath_cache_cs);
+    LIST_FOR_EACH_ENTRY(entry, &properties->xpathCache, xpath_cache_entry, entry)
+    {
+        if (entry->xpath == xpath && xmlStrEqual(entry->query, query))
+        {
+            list_remove(&entry->entry);
+            properties->xpathCache_count--;
+            found = entry;
+            break;
+        }
+    }
+    LeaveCriticalSection(&xpath_cache_cs);
+
+    if (!found) return NULL;
+
+    TRACE("using cached expression for %s\n", debugstr_a((const char *)query));
+    comp = found->comp;
+    found->comp = NULL;
+    free_xpath_cache_entry(found);
+    return comp;
+}
+
+/* Takes ownership of comp, either caching it or freeing it. */
+void xmldoc_put_xpath(xmlDocPtr doc, BOOL xpath, const xmlChar *query, xmlXPathCompExprPtr comp)
+{
+    domdoc_properties *properties = properties_from_xmlDocPtr(doc);
+    xpath_cache_entry *entry, *evicted = NULL;
+    int len = xmlStrlen(query) + 1;
+
+    if (!(entry = heap_alloc(sizeof(*entry))) || !(entry->query = heap_alloc(len)))
+    {
+        heap_free(entry);
+        xmlXPathFreeCompExpr(comp);
+        return;
+    }
+    memcpy(entry->query, query, len);
+    entry->xpath = xpath;
+    entry->comp = comp;
+
+    EnterCriticalSection(&xpath_cache_cs);
+    list_add_head(&properties->xpathCache, &entry->entry);
+    if (++properties->xpathCache_count > XPATH_CACHE_SIZE)
+    {
+        evicted = LIST_ENTRY(list_tail(&properties->xpathCache), xpath_cache_entry, entry);
+        list_remove(&evicted->entry);
+        properties->xpathCache_count--;
+    }
+    LeaveCriticalSection(&xpath_cache_cs);
+
+    if (evicted) free_xpath_cache_entry(evicted);
+}
+
 static xmldoc_priv * create_priv(void)
 {
     xmldoc_priv *priv;
@@ -291,6 +398,8 @@ static domdoc_properties *create_properties(MSXML_VERSION version)
     properties->schemaCache = NULL;
     properties->selectNsStr = heap_alloc_zero(sizeof(xmlChar));
     properties->selectNsStr_len = 0;
+    list_init(&properties->xpathCache);
+    properties->xpathCache_count = 0;
 
     /* properties that are dependent on object versions */
     properties->version = version;
@@ -321,6 +430,8 @@ static domdoc_properties* copy_properties(domdoc_properties const* properties)
         pcopy->XPath = properties->XPath;
         pcopy->selectNsStr_len = properties->selectNsStr_len;
         list_init( &pcopy->selectNsList );
+        list_init( &pcopy->xpathCache );
+        pcopy->xpathCache_count = 0;
         pcopy->selectNsStr = heap_alloc(len);
         memcpy((xmlChar*)pcopy->selectNsStr, properties->selectNsStr, len);
         offset = pcopy->selectNsStr - properties->selectNsStr;
@@ -371,6 +482,7 @@ static void properties_release(domdoc_properties *properties)
         if (properties->schemaCache)
             IXMLDOMSchemaCollection2_Release(properties->schemaCache);
         clear_selectNsList(&properties->selectNsList);
+        clear_xpath_cache(properties);
         heap_free((xmlChar*)properties->selectNsStr);
         if (properties->uri)
             IUri_Release(properties->uri);
@@ -504,61 +616,52 @@ static void sax_serror(void* ctx, xmlErrorPtr err)
     LIBXML2_CALLBACK_SERROR(doparse, err);
 }
 
-static xmlDocPtr doparse(domdoc* This, char const* ptr, int len, xmlCharEncoding encoding)
-{
-    xmlDocPtr doc = NULL;
-    xmlParserCtxtPtr pctx;
-    static xmlSAXHandler sax_handler = {
-        xmlSAX2InternalSubset,          /* internalSubset */
-        xmlSAX2IsStandalone,            /* isStandalone */
-        xmlSAX2HasInternalSubset,       /* hasInternalSubset */
-        xmlSAX2HasExternalSubset,       /* hasExternalSubset */
-        xmlSAX2ResolveEntity,           /* resolveEntity */
-        xmlSAX2GetEntity,               /* getEntity */
-        xmlSAX2EntityDecl,              /* entityDecl */
-        xmlSAX2NotationDecl,            /* notationDecl */
-        xmlSAX2AttributeDecl,           /* attributeDecl */
-        xmlSAX2ElementDecl,             /* elementDecl */
-        xmlSAX2UnparsedEntityDecl,      /* unparsedEntityDecl */
-        xmlSAX2SetDocumentLocator,      /* setDocumentLocator */
-        xmlSAX2StartDocument,           /* startDocument */
-        xmlSAX2EndDocument,             /* endDocument */
-        xmlSAX2StartElement,            /* startElement */
-        xmlSAX2EndElement,              /* endElement */
-        xmlSAX2Reference,               /* reference */
-        sax_characters,                 /* characters */
-        sax_characters,                 /* ignorableWhitespace */
-        xmlSAX2ProcessingInstruction,   /* processingInstruction */
-        xmlSAX2Comment,                 /* comment */
-        sax_warning,                    /* warning */
-        sax_error,                      /* error */
-        sax_error,                      /* fatalError */
-        xmlSAX2GetParameterEntity,      /* getParameterEntity */
-        xmlSAX2CDataBlock,              /* cdataBlock */
-        xmlSAX2ExternalSubset,          /* externalSubset */
-        0,                              /* initialized */
-        NULL,                           /* _private */
-        xmlSAX2StartElementNs,          /* startElementNs */
-        xmlSAX2EndElementNs,            /* endElementNs */
-        sax_serror                      /* serror */
-    };
-
-    pctx = xmlCreateMemoryParserCtxt(ptr, len);
-    if (!pctx)
-    {
-        ERR("Failed to create parser context\n");
-        return NULL;
-    }
+static xmlSAXHandler sax_handler = {
+    xmlSAX2InternalSubset,          /* internalSubset */
+    xmlSAX2IsStandalone,            /* isStandalone */
+    xmlSAX2HasInternalSubset,       /* hasInternalSubset */
+    xmlSAX2HasExternalSubset,       /* hasExternalSubset */
+    xmlSAX2ResolveEntity,           /* resolveEntity */
+    xmlSAX2GetEntity,               /* getEntity */
+    xmlSAX2EntityDecl,              /* entityDecl */
+    xmlSAX2NotationDecl,            /* notationDecl */
+    xmlSAX2AttributeDecl,           /* attributeDecl */
+    xmlSAX2ElementDecl,             /* elementDecl */
+    xmlSAX2UnparsedEntityDecl,      /* unparsedEntityDecl */
+    xmlSAX2SetDocumentLocator,      /* setDocumentLocator */
+    xmlSAX2StartDocument,           /* startDocument */
+    xmlSAX2EndDocument,             /* endDocument */
+    xmlSAX2StartElement,            /* startElement */
+    xmlSAX2EndElement,              /* endElement */
+    xmlSAX2Reference,               /* reference */
+    sax_characters,                 /* characters */
+    sax_characters,                 /* ignorableWhitespace */
+    xmlSAX2ProcessingInstruction,   /* processingInstruction */
+    xmlSAX2Comment,                 /* comment */
+    sax_warning,                    /* warning */
+    sax_error,                      /* error */
+    sax_error,                      /* fatalError */
+    xmlSAX2GetParameterEntity,      /* getParameterEntity */
+    xmlSAX2CDataBlock,              /* cdataBlock */
+    xmlSAX2ExternalSubset,          /* externalSubset */
+    0,                              /* initialized */
+    NULL,                           /* _private */
+    xmlSAX2StartElementNs,          /* startElementNs */
+    xmlSAX2EndElementNs,            /* endElementNs */
+    sax_serror                      /* serror */
+};
 
+static void init_parser_ctxt(domdoc *This, xmlParserCtxtPtr pctx)
+{
     if (pctx->sax) xmlFree(pctx->sax);
     pctx->sax = &sax_handler;
     pctx->_private = This;
     pctx->recovery = 0;
+}
 
-    if (encoding != XML_CHAR_ENCODING_NONE)
-        xmlSwitchEncoding(pctx, encoding);
-
-    xmlParseDocument(pctx);
+static xmlDocPtr finish_parse(xmlParserCtxtPtr pctx)
+{
+    xmlDocPtr doc = NULL;
 
     if (pctx->wellFormed)
     {
@@ -604,6 +707,69 @@ static xmlDocPtr doparse(domdoc* This, char const* ptr, int len, xmlCharEncoding
     return doc;
 }
 
+static xmlDocPtr doparse(domdoc* This, char const* ptr, int len, xmlCharEncoding encoding)
+{
+    xmlParserCtxtPtr pctx;
+
+    pctx = xmlCreateMemoryParserCtxt(ptr, len);
+    if (!pctx)
+    {
+        ERR("Failed to create parser context\n");
+        return NULL;
+    }
+
+    init_parser_ctxt(This, pctx);
+
+    if (encoding != XML_CHAR_ENCODING_NONE)
+        xmlSwitchEncoding(pctx, encoding);
+
+    xmlParseDocument(pctx);
+
+    return finish_parse(pctx);
+}
+
+/* Feeds the stream to a push parser as it's read, so the whole
+ * document never has to be buffered before parsing. */
+static xmlDocPtr doparse_stream(domdoc *This, ISequentialStream *stream)
+{
+    xmlParserCtxtPtr pctx;
+    ULONG read, len = 0;
+    char buf[4096];
+
+    /* encoding detection looks at the first bytes, so fill the first chunk */
+    do
+    {
+        read = 0;
+        ISequentialStream_Read(stream, buf + len, sizeof(buf) - len, &read);
+        len += read;
+    } while (read && len < sizeof(buf));
+
+    if (!len)
+        return NULL;
+
+    pctx = xmlCreatePushParserCtxt(NULL, NULL, buf, len, NULL);
+    if (!pctx)
+    {
+        ERR("Failed to create parser context\n");
+        return NULL;
+    }
+
+    init_parser_ctxt(This, pctx);
+    /* push parsers store names in a dictionary, nodes can be moved between documents */
+    pctx->dictNames = 0;
+
+    do
+    {
+        read = 0;
+        ISequentialStream_Read(stream, buf, sizeof(buf), &read);
+        if (read) xmlParseChunk(pctx, buf, read, 0);
+    } while (read && pctx->wellFormed);
+
+    xmlParseChunk(pctx, NULL, 0, 1);
+
+    return finish_parse(pctx);
+}
+
 void xmldoc_init(xmlDocPtr doc, MSXML_VERSION version)
 {
     doc->_private = create_priv();
@@ -797,46 +963,9 @@ static HRESULT WINAPI PersistStreamInit_IsDirty(
 
 static HRESULT domdoc_load_from_stream(domdoc *doc, ISequentialStream *stream)
 {
-    DWORD read, written, len;
-    xmlDocPtr xmldoc = NULL;
-    IStream *hstream;
-    HGLOBAL hglobal;
-    BYTE buf[4096];
-    HRESULT hr;
-    char *ptr;
-
-    hstream = NULL;
-    hr = CreateStreamOnHGlobal(NULL, TRUE, &hstream);
-    if (FAILED(hr))
-        return hr;
-
-    do
-    {
-        ISequentialStream_Read(stream, buf, sizeof(buf), &read);
-        hr = IStream_Write(hstream, buf, read, &written);
-    } while(SUCCEEDED(hr) && written != 0 && read != 0);
-
-    if (FAILED(hr))
-    {
-        ERR("failed to copy stream 0x%08x\n", hr);
-        IStream_Release(hstream);
-        return hr;
-    }
-
-    hr = GetHGlobalFromStream(hstream, &hglobal);
-    if (FAILED(hr))
-    {
-        IStream_Release(hstream);
-        return hr;
-    }
-
-    len = GlobalSize(hglobal);
-    ptr = GlobalLock(hglobal);
-    if (len)
-        xmldoc = doparse(doc, ptr, len, XML_CHAR_ENCODING_NONE);
-    GlobalUnlock(hglobal);
-    IStream_Release(hstream);
+    xmlDocPtr xmldoc;
 
+    xmldoc = doparse_stream(doc, stream);
     if (!xmldoc)
     {
         ERR("Failed to parse xml\n");
@@ -3073,6 +3202,7 @@ static HRESULT WINAPI domdoc_setProperty(
 
         pNsList = &(This->properties->selectNsList);
         clear_selectNsList(pNsList);
+        clear_xpath_cache(This->properties);
         heap_free(nsStr);
         nsStr = xmlchar_from_wchar(bstr);
 
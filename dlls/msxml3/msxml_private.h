@@ -208,6 +208,10 @@ extern BOOL is_preserving_whitespace(xmlNodePtr node) DECLSPEC_HIDDEN;
 extern BOOL is_xpathmode(const xmlDocPtr doc) DECLSPEC_HIDDEN;
 extern void set_xpathmode(xmlDocPtr doc, BOOL xpath) DECLSPEC_HIDDEN;
 
+#include <libxml/xpath.h>
+extern xmlXPathCompExprPtr xmldoc_get_xpath(xmlDocPtr doc, BOOL xpath, const xmlChar *query) DECLSPEC_HIDDEN;
+extern void xmldoc_put_xpath(xmlDocPtr doc, BOOL xpath, const xmlChar *query, xmlXPathCompExprPtr comp) DECLSPEC_HIDDEN;
+
 extern void init_xmlnode(xmlnode*,xmlNodePtr,IXMLDOMNode*,dispex_static_data_t*) DECLSPEC_HIDDEN;
 extern void destroy_xmlnode(xmlnode*) DECLSPEC_HIDDEN;
 extern BOOL node_query_interface(xmlnode*,REFIID,void**) DECLSPEC_HIDDEN;
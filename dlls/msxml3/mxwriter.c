@@ -383,6 +383,15 @@ static HRESULT write_output_buffer(mxwriter *writer, const WCHAR *data, int len)
             unsigned int avail = buff->allocated - buff->written;
             int length;
 
+            /* no supported encoding takes more than 3 bytes per character,
+               so most fragments can be converted without measuring them first */
+            if (avail / 3 >= src_len)
+            {
+                length = WideCharToMultiByte(buffer->code_page, 0, data, src_len, buff->data + buff->written, avail, NULL, NULL);
+                buff->written += length;
+                return S_OK;
+            }
+
             length = WideCharToMultiByte(buffer->code_page, 0, data, src_len, NULL, 0, NULL, NULL);
             if (avail >= length)
             {
@@ -499,76 +508,63 @@ static void close_output_buffer(mxwriter *writer)
     list_init(&writer->buffer.blocks);
 }
 
-/* Escapes special characters like:
+/* Writes a string escaping special characters like:
    '<' -> "&lt;"
    '&' -> "&amp;"
    '"' -> "&quot;"
    '>' -> "&gt;"
 
-   On call 'len' contains a length of 'str' in chars or -1 if it's null terminated.
-   After a call it's updated with actual new length if it wasn't -1 initially.
+   Runs of characters that don't need escaping are written as is,
+   without making an escaped copy of the whole string first.
 */
-static WCHAR *get_escaped_string(const WCHAR *str, escape_mode mode, int *len)
+static void write_output_buffer_escaped(mxwriter *writer, const WCHAR *str, int len, escape_mode mode)
 {
     static const WCHAR ltW[]    = {'&','l','t',';'};
     static const WCHAR ampW[]   = {'&','a','m','p',';'};
     static const WCHAR equotW[] = {'&','q','u','o','t',';'};
     static const WCHAR gtW[]    = {'&','g','t',';'};
 
-    const int default_alloc = 100;
-    const int grow_thresh = 10;
-    int p = *len, conv_len;
-    WCHAR *ptr, *ret;
-
-    /* default buffer size to something if length is unknown */
-    conv_len = max(2**len, default_alloc);
-    ptr = ret = heap_alloc(conv_len*sizeof(WCHAR));
+    const WCHAR *start = str, *end = str + len;
 
-    while (p)
+    for (; str < end; str++)
     {
-        if (ptr - ret > conv_len - grow_thresh)
-        {
-            int written = ptr - ret;
-            conv_len *= 2;
-            ptr = ret = heap_realloc(ret, conv_len*sizeof(WCHAR));
-            ptr += written;
-        }
+        const WCHAR *entity;
+        int entity_len;
 
         switch (*str)
         {
         case '<':
-            memcpy(ptr, ltW, sizeof(ltW));
-            ptr += ARRAY_SIZE(ltW);
+            entity = ltW;
+            entity_len = ARRAY_SIZE(ltW);
             break;
         case '&':
-            memcpy(ptr, ampW, sizeof(ampW));
-            ptr += ARRAY_SIZE(ampW);
+            entity = ampW;
+            entity_len = ARRAY_SIZE(ampW);
             break;
         case '>':
-            memcpy(ptr, gtW, sizeof(gtW));
-            ptr += ARRAY_SIZE(gtW);
+            entity = gtW;
+            entity_len = ARRAY_SIZE(gtW);
             break;
         case '"':
             if (mode == EscapeValue)
             {
-                memcpy(ptr, equotW, sizeof(equotW));
-                ptr += ARRAY_SIZE(equotW);
+                entity = equotW;
+                entity_len = ARRAY_SIZE(equotW);
                 break;
             }
             /* fallthrough for text mode */
         default:
-            *ptr++ = *str;
-            break;
+            continue;
         }
 
-        str++;
-        p--;
+        if (str > start)
+            write_output_buffer(writer, start, str - start);
+        write_output_buffer(writer, entity, entity_len);
+        start = str + 1;
     }
 
-    *len = ptr-ret;
-    *++ptr = 0;
-
-    return ret;
+    if (str > start)
+        write_output_buffer(writer, start, str - start);
 }
 
 static void write_prolog_buffer(mxwriter *writer)
@@ -1294,9 +1290,9 @@ static void mxwriter_write_attribute(mxwriter *writer, const WCHAR *qname, int q
 
     if (escape)
     {
-        WCHAR *escaped = get_escaped_string(value, EscapeValue, &value_len);
-        write_output_buffer_quoted(writer, escaped, value_len);
-        heap_free(escaped);
+        write_output_buffer(writer, quotW, 1);
+        write_output_buffer_escaped(writer, value, value_len, EscapeValue);
+        write_output_buffer(writer, quotW, 1);
     }
     else
         write_output_buffer_quoted(writer, value, value_len);
@@ -1430,14 +1426,7 @@ static HRESULT WINAPI SAXContentHandler_characters(
         if (This->cdata || This->props[MXWriter_DisableEscaping] == VARIANT_TRUE)
             write_output_buffer(This, chars, nchars);
         else
-        {
-            int len = nchars;
-            WCHAR *escaped;
-
-            escaped = get_escaped_string(chars, EscapeText, &len);
-            write_output_buffer(This, escaped, len);
-            heap_free(escaped);
-        }
+            write_output_buffer_escaped(This, chars, nchars, EscapeText);
     }
 
     return S_OK;
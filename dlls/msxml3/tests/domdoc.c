@@ -5059,6 +5059,21 @@ if (0)
     ole_check(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//elem[0]"), &list));
     expect_list_and_release(list, "");
 
+    /* the same query selects the first element in XSLPattern, switching
+       the language must not reuse the query compiled for the other one */
+    ole_check(IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionLanguage"), _variantbstr_("XSLPattern")));
+    ole_check(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//elem[0]"), &list));
+    expect_list_and_release(list, "E1.E2.D1");
+    ole_check(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//elem[0]"), &list));
+    expect_list_and_release(list, "E1.E2.D1");
+    ole_check(IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionLanguage"), _variantbstr_("XPath")));
+    ole_check(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//elem[0]"), &list));
+    expect_list_and_release(list, "");
+    ole_check(IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionLanguage"), _variantbstr_("XSLPattern")));
+    ole_check(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//elem[0]"), &list));
+    expect_list_and_release(list, "E1.E2.D1");
+    ole_check(IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionLanguage"), _variantbstr_("XPath")));
+
     /* foo undeclared in document node */
     ole_expect(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//foo:c"), &list), E_FAIL);
     /* undeclared in <root> node */
@@ -5083,6 +5098,27 @@ if (0)
     ole_check(IXMLDOMNode_selectNodes(elem1Node, _bstr_(".//test:x"), &list));
     expect_list_and_release(list, "E6.E1.E5.E1.E2.D1 E6.E2.E5.E1.E2.D1");
 
+    /* rebinding the prefix affects queries that were already used */
+    ole_check(IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionNamespaces"),
+        _variantbstr_("xmlns:test='http://www.winehq.org'")));
+    ole_check(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//test:c"), &list));
+    expect_list_and_release(list, "");
+    ole_check(IXMLDOMNode_selectNodes(elem1Node, _bstr_(".//test:x"), &list));
+    expect_list_and_release(list, "");
+    /* and binding it back selects the original nodes again */
+    ole_check(IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionNamespaces"),
+        _variantbstr_("xmlns:test='urn:uuid:86B2F87F-ACB6-45cd-8B77-9BDB92A01A29'")));
+    ole_check(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//test:c"), &list));
+    expect_list_and_release(list, "E3.E3.E2.D1 E3.E4.E2.D1");
+    ole_check(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//test:c"), &list));
+    expect_list_and_release(list, "E3.E3.E2.D1 E3.E4.E2.D1");
+    /* while dropping it makes them fail */
+    ole_check(IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionNamespaces"),
+        _variantbstr_("xmlns:foo='urn:uuid:86B2F87F-ACB6-45cd-8B77-9BDB92A01A29'")));
+    ole_expect(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//test:c"), &list), E_FAIL);
+    ole_check(IXMLDOMDocument2_selectNodes(doc, _bstr_("root//foo:c"), &list));
+    expect_list_and_release(list, "E3.E3.E2.D1 E3.E4.E2.D1");
+
     /* SelectionNamespaces syntax error - the namespaces doesn't work anymore but the value is stored */
     ole_expect(IXMLDOMDocument2_setProperty(doc, _bstr_("SelectionNamespaces"),
         _variantbstr_("xmlns:test='urn:uuid:86B2F87F-ACB6-45cd-8B77-9BDB92A01A29' xmlns:foo=###")), E_FAIL);
@@ -10818,6 +10854,69 @@ static void test_load(void)
     free_bstrs();
 }
 
+static void test_load_stream_move_node(void)
+{
+    IXMLDOMDocument *doc, *doc2;
+    IXMLDOMElement *root, *elem;
+    IXMLDOMNode *node;
+    IStream *stream;
+    VARIANT src, v;
+    VARIANT_BOOL b;
+    HRESULT hr;
+    BSTR str;
+
+    doc = create_document(&IID_IXMLDOMDocument);
+
+    stream = SHCreateMemStream((const BYTE*)complete4A, strlen(complete4A));
+    V_VT(&src) = VT_UNKNOWN;
+    V_UNKNOWN(&src) = (IUnknown*)stream;
+    b = VARIANT_FALSE;
+    hr = IXMLDOMDocument_load(doc, src, &b);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    ok(b == VARIANT_TRUE, "got %d\n", b);
+    VariantClear(&src);
+
+    hr = IXMLDOMDocument_selectSingleNode(doc, _bstr_("lc/pr"), &node);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    doc2 = create_document(&IID_IXMLDOMDocument);
+    hr = IXMLDOMDocument_loadXML(doc2, _bstr_("<root/>"), &b);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    hr = IXMLDOMDocument_get_documentElement(doc2, &root);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+
+    /* the moved node must not depend on the document it was loaded in */
+    hr = IXMLDOMElement_appendChild(root, node, NULL);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    IXMLDOMDocument_Release(doc);
+
+    hr = IXMLDOMNode_get_nodeName(node, &str);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    expect_bstr_eq_and_free(str, "pr");
+
+    hr = IXMLDOMNode_QueryInterface(node, &IID_IXMLDOMElement, (void**)&elem);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    hr = IXMLDOMElement_getAttribute(elem, _bstr_("pn"), &v);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    ok(V_VT(&v) == VT_BSTR, "got type %d\n", V_VT(&v));
+    expect_bstr_eq_and_free(V_BSTR(&v), "wine 20050804");
+    IXMLDOMElement_Release(elem);
+
+    hr = IXMLDOMElement_get_xml(root, &str);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    ok(!memcmp(str, L"<root><pr id=\"str3\"", 19 * sizeof(WCHAR)), "got %s\n", wine_dbgstr_w(str));
+    SysFreeString(str);
+
+    /* freeing the node in a document that doesn't use a dictionary */
+    hr = IXMLDOMElement_removeChild(root, node, NULL);
+    ok(hr == S_OK, "got 0x%08x\n", hr);
+    IXMLDOMNode_Release(node);
+
+    IXMLDOMElement_Release(root);
+    IXMLDOMDocument_Release(doc2);
+    free_bstrs();
+}
+
 static void test_domobj_dispex(IUnknown *obj)
 {
     DISPID dispid = DISPID_XMLDOM_NODELIST_RESET;
@@ -13784,6 +13883,7 @@ START_TEST(domdoc)
     test_get_attributes();
     test_selection();
     test_load();
+    test_load_stream_move_node();
     test_dispex();
     test_parseerror();
     test_getAttributeNode();
@@ -1290,6 +1290,59 @@ static void test_directory(void)
     pNtClose(dir);
 }
 
+static void test_many_names(void)
+{
+    static const unsigned int count = 2000;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING str;
+    HANDLE dir, *handles, h;
+    WCHAR name[32];
+    NTSTATUS status;
+    unsigned int i;
+
+    InitializeObjectAttributes( &attr, NULL, 0, 0, NULL );
+    status = pNtCreateDirectoryObject( &dir, DIRECTORY_QUERY | DIRECTORY_CREATE_OBJECT, &attr );
+    ok( status == STATUS_SUCCESS, "Failed to create directory %08x\n", status );
+
+    handles = malloc( count * sizeof(*handles) );
+    InitializeObjectAttributes( &attr, &str, 0, dir, NULL );
+    for (i = 0; i < count; i++)
+    {
+        swprintf( name, ARRAY_SIZE(name), L"om.c-event-%u", i );
+        RtlInitUnicodeString( &str, name );
+        status = pNtCreateEvent( &handles[i], EVENT_ALL_ACCESS, &attr, NotificationEvent, FALSE );
+        ok( status == STATUS_SUCCESS, "%u: NtCreateEvent failed %08x\n", i, status );
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        swprintf( name, ARRAY_SIZE(name), L"om.c-event-%u", i );
+        RtlInitUnicodeString( &str, name );
+        status = pNtOpenEvent( &h, EVENT_ALL_ACCESS, &attr );
+        ok( status == STATUS_SUCCESS, "%u: NtOpenEvent failed %08x\n", i, status );
+        if (!status) pNtClose( h );
+    }
+
+    for (i = 0; i < count; i += 2) pNtClose( handles[i] );
+
+    for (i = 0; i < count; i++)
+    {
+        swprintf( name, ARRAY_SIZE(name), L"OM.C-EVENT-%u", i );
+        RtlInitUnicodeString( &str, name );
+        attr.Attributes = OBJ_CASE_INSENSITIVE;
+        status = pNtOpenEvent( &h, EVENT_ALL_ACCESS, &attr );
+        if (i % 2)
+            ok( status == STATUS_SUCCESS, "%u: NtOpenEvent failed %08x\n", i, status );
+        else
+            ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "%u: NtOpenEvent got %08x\n", i, status );
+        if (!status) pNtClose( h );
+    }
+
+    for (i = 1; i < count; i += 2) pNtClose( handles[i] );
+    free( handles );
+    pNtClose( dir );
+}
+
 static void test_symboliclink(void)
 {
     NTSTATUS status;
@@ -2550,6 +2603,7 @@ START_TEST(om)
     test_name_collisions();
     test_name_limits();
     test_directory();
+    test_many_names();
     test_symboliclink();
     test_query_object();
     test_type_mismatch();
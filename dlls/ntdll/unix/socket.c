@@ -41,6 +41,12 @@
 #ifdef HAVE_NETINET_TCP_H
 # include <netinet/tcp.h>
 #endif
+#ifdef HAVE_NETINET_UDP_H
+# include <netinet/udp.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 
 #ifdef HAVE_NETIPX_IPX_H
 # include <netipx/ipx.h>
@@ -89,6 +95,10 @@
 #define IP_UNICAST_IF 50
 #endif
 
+#if defined(linux) && !defined(UDP_SEGMENT)
+#define UDP_SEGMENT 103
+#endif
+
 WINE_DEFAULT_DEBUG_CHANNEL(winsock);
 
 #define u64_to_user_ptr(u) ((void *)(uintptr_t)(u))
@@ -142,6 +152,7 @@ struct async_transmit_ioctl
     unsigned int buffer_cursor; /* amount of data currently in the buffer already sent */
     unsigned int tail_cursor;   /* amount of tail data already sent */
     unsigned int file_len;      /* total file length to send */
+    BOOL no_sendfile;           /* sendfile() failed, use read() and send() instead */
     DWORD flags;
     const char *head;
     const char *tail;
@@ -944,6 +955,31 @@ static ssize_t do_send( int fd, const void *buffer, size_t len, int flags )
     return ret;
 }
 
+#ifdef HAVE_SYS_SENDFILE_H
+/* sendfile() errors can come from either the socket or the file */
+static NTSTATUS sendfile_errno_to_status( int err )
+{
+    switch (err)
+    {
+    case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+    case EWOULDBLOCK:
+#endif
+    case EPIPE:
+    case ECONNABORTED:
+    case ECONNRESET:
+    case ENOTCONN:
+    case ENETDOWN:
+    case ENETUNREACH:
+    case EHOSTUNREACH:
+    case EMSGSIZE:
+        return sock_errno_to_status( err );
+    default:
+        return errno_to_status( err );
+    }
+}
+#endif
+
 static NTSTATUS try_transmit( int sock_fd, int file_fd, struct async_transmit_ioctl *async )
 {
     ssize_t ret;
@@ -969,6 +1005,48 @@ static NTSTATUS try_transmit( int sock_fd, int file_fd, struct async_transmit_io
         async->file_cursor += ret;
     }
 
+#ifdef HAVE_SYS_SENDFILE_H
+    /* let the kernel copy the file data directly to the socket */
+    while (async->file && !async->no_sendfile && async->buffer_cursor == async->read_len)
+    {
+        size_t count = async->buffer_size;
+        off_t offset;
+
+        if (async->file_len)
+            count = min( count, async->file_len - async->file_cursor );
+
+        TRACE( "sending %zu bytes of file data with sendfile\n", count );
+        if (async->offset.QuadPart == FILE_USE_FILE_POINTER_POSITION)
+            ret = sendfile( sock_fd, file_fd, NULL, count );
+        else
+        {
+            offset = async->offset.QuadPart;
+            ret = sendfile( sock_fd, file_fd, &offset, count );
+        }
+        if (ret < 0)
+        {
+            if (errno == EINTR) continue;
+            /* the file can't be mapped (EINVAL), or sendfile() isn't implemented */
+            if (errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)
+            {
+                TRACE( "sendfile not supported for this file, falling back to read\n" );
+                async->no_sendfile = TRUE;
+                break;
+            }
+            if (errno != EWOULDBLOCK) WARN( "sendfile: %s\n", strerror( errno ) );
+            return sendfile_errno_to_status( errno );
+        }
+        TRACE( "sendfile returned %zd\n", ret );
+
+        async->file_cursor += ret;
+        if (async->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+            async->offset.QuadPart += ret;
+
+        if (!ret || (async->file_len && async->file_cursor == async->file_len))
+            async->file = NULL;
+    }
+#endif
+
     if (async->file && async->buffer_cursor == async->read_len)
     {
         unsigned int read_size = async->buffer_size;
@@ -1087,6 +1165,7 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
     async->buffer_cursor = 0;
     async->tail_cursor = 0;
     async->file_len = params->file_len;
+    async->no_sendfile = FALSE;
     async->flags = params->flags;
     async->head = u64_to_user_ptr(params->head_ptr);
     async->head_len = params->head_len;
@@ -1112,6 +1191,17 @@ static NTSTATUS sock_transmit( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc,
 
     if (status != STATUS_PENDING) release_fileio( &async->io );
 
+    /* the server delays the shutdown until the queued transmit has completed */
+    if (status == STATUS_PENDING && (params->flags & (TF_DISCONNECT | TF_REUSE_SOCKET)))
+    {
+        IO_STATUS_BLOCK shutdown_io;
+        int how = SD_SEND;
+
+        if (params->flags & TF_REUSE_SOCKET) FIXME( "reusing socket not supported yet\n" );
+        NtDeviceIoControlFile( handle, NULL, NULL, NULL, &shutdown_io, IOCTL_AFD_WINE_SHUTDOWN,
+                               &how, sizeof(how), NULL, 0 );
+    }
+
     if (wait_handle) status = wait_async( wait_handle, options & FILE_SYNCHRONOUS_IO_ALERT );
     return status;
 }
@@ -2192,6 +2282,17 @@ NTSTATUS sock_ioctl( HANDLE handle, HANDLE event, PIO_APC_ROUTINE apc, void *apc
         case IOCTL_AFD_WINE_SET_TCP_NODELAY:
             return do_setsockopt( handle, io, IPPROTO_TCP, TCP_NODELAY, in_buffer, in_size );
 
+#ifdef UDP_SEGMENT
+        /* segmentation offload lets a single send carry a whole batch of datagrams */
+        case IOCTL_AFD_WINE_GET_UDP_SEND_MSG_SIZE:
+            if (get_sock_type( handle ) != SOCK_DGRAM) return STATUS_INVALID_PARAMETER;
+            return do_getsockopt( handle, io, IPPROTO_UDP, UDP_SEGMENT, out_buffer, out_size );
+
+        case IOCTL_AFD_WINE_SET_UDP_SEND_MSG_SIZE:
+            if (get_sock_type( handle ) != SOCK_DGRAM) return STATUS_INVALID_PARAMETER;
+            return do_setsockopt( handle, io, IPPROTO_UDP, UDP_SEGMENT, in_buffer, in_size );
+#endif
+
         default:
         {
             if ((code >> 16) == FILE_DEVICE_NETWORK)
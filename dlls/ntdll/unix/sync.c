@@ -1850,20 +1850,32 @@ NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORM
     {
         while (i < count)
         {
-            SERVER_START_REQ( remove_completion )
+            completion_packet_t packets[64];
+            ULONG j, wanted = min( count - i, ARRAY_SIZE(packets) ), got = 0;
+
+            /* dequeue as many packets as we can in a single request */
+            SERVER_START_REQ( remove_completions )
             {
                 req->handle = wine_server_obj_handle( handle );
+                wine_server_set_reply( req, packets, wanted * sizeof(*packets) );
                 if (!(status = wine_server_call( req )))
-                {
-                    info[i].CompletionKey             = reply->ckey;
-                    info[i].CompletionValue           = reply->cvalue;
-                    info[i].IoStatusBlock.Information = reply->information;
-                    info[i].IoStatusBlock.u.Status    = reply->status;
-                }
+                    got = wine_server_reply_size( reply ) / sizeof(*packets);
             }
             SERVER_END_REQ;
             if (status != STATUS_SUCCESS) break;
-            ++i;
+            for (j = 0; j < got; j++, i++)
+            {
+                info[i].CompletionKey             = packets[j].ckey;
+                info[i].CompletionValue           = packets[j].cvalue;
+                info[i].IoStatusBlock.Information = packets[j].information;
+                info[i].IoStatusBlock.u.Status    = packets[j].status;
+            }
+            /* a short reply means the queue has been drained */
+            if (got < wanted)
+            {
+                status = STATUS_PENDING;
+                break;
+            }
         }
         if (i || status != STATUS_PENDING)
         {
@@ -2595,17 +2595,19 @@ NTSTATUS WINAPI NtQuerySystemInformation( SYSTEM_INFORMATION_CLASS class,
 
     case SystemTimeOfDayInformation:  /* 3 */
     {
-        struct tm *tm;
-        time_t now;
         SYSTEM_TIMEOFDAY_INFORMATION sti = {{{ 0 }}};
+        ULONG low;
+        LONG high;
 
         sti.BootTime.QuadPart = server_start_time;
-        now = time( NULL );
-        tm = gmtime( &now );
-        sti.TimeZoneBias.QuadPart = mktime( tm ) - now;
-        tm = localtime( &now );
-        if (tm->tm_isdst) sti.TimeZoneBias.QuadPart -= 3600;
-        sti.TimeZoneBias.QuadPart *= TICKSPERSEC;
+        /* the server keeps the time zone bias up to date in the shared data page */
+        do
+        {
+            high = user_shared_data->TimeZoneBias.High1Time;
+            low = user_shared_data->TimeZoneBias.LowPart;
+        }
+        while (high != user_shared_data->TimeZoneBias.High2Time);
+        sti.TimeZoneBias.QuadPart = (LONGLONG)high << 32 | low;
         NtQuerySystemTime( &sti.SystemTime );
 
         if (size <= sizeof(sti))
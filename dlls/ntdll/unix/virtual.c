@@ -2722,22 +2722,30 @@ ULONG_PTR get_system_affinity_mask(void)
  */
 void virtual_get_system_info( SYSTEM_BASIC_INFORMATION *info, BOOL wow64 )
 {
+    /* the amount of physical memory doesn't change, only query it once */
+    static ULONG highest_physical_page;
+
+    if (!highest_physical_page)
+    {
 #if defined(HAVE_SYSINFO) \
     && defined(HAVE_STRUCT_SYSINFO_TOTALRAM) && defined(HAVE_STRUCT_SYSINFO_MEM_UNIT)
-    struct sysinfo sinfo;
+        struct sysinfo sinfo;
 
-    if (!sysinfo(&sinfo))
-    {
-        ULONG64 total = (ULONG64)sinfo.totalram * sinfo.mem_unit;
-        info->MmHighestPhysicalPage = max(1, total / page_size);
-    }
+        if (!sysinfo(&sinfo))
+        {
+            ULONG64 total = (ULONG64)sinfo.totalram * sinfo.mem_unit;
+            highest_physical_page = max(1, total / page_size);
+        }
 #elif defined(_SC_PHYS_PAGES)
-    LONG64 phys_pages = sysconf( _SC_PHYS_PAGES );
+        LONG64 phys_pages = sysconf( _SC_PHYS_PAGES );
 
-    info->MmHighestPhysicalPage = max(1, phys_pages);
+        highest_physical_page = max(1, phys_pages);
 #else
-    info->MmHighestPhysicalPage = 0x7fffffff / page_size;
+        highest_physical_page = 0x7fffffff / page_size;
 #endif
+    }
+
+    info->MmHighestPhysicalPage = highest_physical_page;
 
     info->unknown                 = 0;
     info->KeMaximumIncrement      = 0;  /* FIXME */
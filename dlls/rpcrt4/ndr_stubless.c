@@ -52,6 +52,120 @@ static inline BOOL is_oicf_stubdesc(const PMIDL_STUB_DESC pStubDesc)
     return pStubDesc->Version >= 0x20000;
 }
 
+/* wire size of the base types that have the same representation in memory
+ * and in the buffer and are aligned to their size, 0 for the others */
+static inline unsigned int simple_basetype_size(unsigned char fc)
+{
+    switch (fc)
+    {
+    case FC_BYTE:
+    case FC_CHAR:
+    case FC_SMALL:
+    case FC_USMALL:
+        return 1;
+    case FC_WCHAR:
+    case FC_SHORT:
+    case FC_USHORT:
+        return 2;
+    case FC_LONG:
+    case FC_ULONG:
+    case FC_ENUM32:
+    case FC_FLOAT:
+        return 4;
+    case FC_HYPER:
+    case FC_DOUBLE:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+/* Size and alignment of parameters that are copied to the buffer as a
+ * single block, i.e. simple base types and structures without pointers.
+ * Returns 0 if the type needs to go through the generic routines. */
+static inline unsigned int simple_type_layout(PFORMAT_STRING pFormat, unsigned int *align)
+{
+    unsigned int size;
+
+    if (pFormat[0] == FC_STRUCT)
+    {
+        *align = pFormat[1] + 1;
+        return *(const WORD *)(pFormat + 2);
+    }
+    size = simple_basetype_size(pFormat[0]);
+    *align = size;
+    return size;
+}
+
+/* The fast paths below must produce exactly the same buffer as the
+ * NdrBaseType* and NdrSimpleStruct* routines they stand in for. */
+static inline BOOL fast_buffer_size(PMIDL_STUB_MESSAGE pStubMsg, PFORMAT_STRING pFormat)
+{
+    unsigned int size, align;
+    ULONG len;
+
+    if (!(size = simple_type_layout(pFormat, &align))) return FALSE;
+
+    len = (pStubMsg->BufferLength + align - 1) & ~(align - 1);
+    if (len + size < len)
+    {
+        ERR("buffer length overflow - BufferLength = %u, size = %u\n", len, size);
+        RpcRaiseException(RPC_X_BAD_STUB_DATA);
+    }
+    pStubMsg->BufferLength = len + size;
+    return TRUE;
+}
+
+static inline BOOL fast_marshall(PMIDL_STUB_MESSAGE pStubMsg, unsigned char *pMemory, PFORMAT_STRING pFormat)
+{
+    unsigned int size, align;
+    ULONG_PTR mask;
+
+    if (!(size = simple_type_layout(pFormat, &align))) return FALSE;
+
+    mask = align - 1;
+    memset(pStubMsg->Buffer, 0, (align - (ULONG_PTR)pStubMsg->Buffer) & mask);
+    pStubMsg->Buffer = (unsigned char *)(((ULONG_PTR)pStubMsg->Buffer + mask) & ~mask);
+    if (pFormat[0] == FC_STRUCT) pStubMsg->BufferMark = pStubMsg->Buffer;
+
+    if ((pStubMsg->Buffer + size < pStubMsg->Buffer) ||
+        (pStubMsg->Buffer + size > (unsigned char *)pStubMsg->RpcMsg->Buffer + pStubMsg->BufferLength))
+    {
+        ERR("buffer overflow - Buffer = %p, size = %u\n", pStubMsg->Buffer, size);
+        RpcRaiseException(RPC_X_BAD_STUB_DATA);
+    }
+    memcpy(pStubMsg->Buffer, pMemory, size);
+    pStubMsg->Buffer += size;
+    return TRUE;
+}
+
+static inline BOOL fast_unmarshall(PMIDL_STUB_MESSAGE pStubMsg, unsigned char **ppMemory, PFORMAT_STRING pFormat)
+{
+    unsigned int size = simple_basetype_size(pFormat[0]);
+    ULONG_PTR mask = size - 1;
+    unsigned char *end;
+
+    if (!size) return FALSE;
+
+    pStubMsg->Buffer = (unsigned char *)(((ULONG_PTR)pStubMsg->Buffer + mask) & ~mask);
+
+    /* servers point straight into the buffer when there is no memory yet */
+    if (!pStubMsg->IsClient && !*ppMemory)
+        end = (unsigned char *)pStubMsg->RpcMsg->Buffer + pStubMsg->BufferLength;
+    else
+        end = pStubMsg->BufferEnd;
+
+    if ((pStubMsg->Buffer + size < pStubMsg->Buffer) || (pStubMsg->Buffer + size > end))
+    {
+        ERR("buffer overflow - Buffer = %p, BufferEnd = %p, size = %u\n", pStubMsg->Buffer, end, size);
+        RpcRaiseException(RPC_X_BAD_STUB_DATA);
+    }
+    if (!pStubMsg->IsClient && !*ppMemory) *ppMemory = pStubMsg->Buffer;
+    else memcpy(*ppMemory, pStubMsg->Buffer, size);
+    pStubMsg->Buffer += size;
+    return TRUE;
+}
+
 static inline void call_buffer_sizer(PMIDL_STUB_MESSAGE pStubMsg, unsigned char *pMemory,
                                      const NDR_PARAM_OIF *param)
 {
@@ -69,6 +183,8 @@ static inline void call_buffer_sizer(PMIDL_STUB_MESSAGE pStubMsg, unsigned char
         if (!param->attr.IsByValue) pMemory = *(unsigned char **)pMemory;
     }
 
+    if (fast_buffer_size(pStubMsg, pFormat)) return;
+
     m = NdrBufferSizer[pFormat[0] & NDR_TABLE_MASK];
     if (m) m(pStubMsg, pMemory, pFormat);
     else
@@ -95,6 +211,8 @@ static inline unsigned char *call_marshaller(PMIDL_STUB_MESSAGE pStubMsg, unsign
         if (!param->attr.IsByValue) pMemory = *(unsigned char **)pMemory;
     }
 
+    if (fast_marshall(pStubMsg, pMemory, pFormat)) return NULL;
+
     m = NdrMarshaller[pFormat[0] & NDR_TABLE_MASK];
     if (m) return m(pStubMsg, pMemory, pFormat);
     else
@@ -122,6 +240,8 @@ static inline unsigned char *call_unmarshaller(PMIDL_STUB_MESSAGE pStubMsg, unsi
         if (!param->attr.IsByValue) ppMemory = (unsigned char **)*ppMemory;
     }
 
+    if (!fMustAlloc && fast_unmarshall(pStubMsg, ppMemory, pFormat)) return NULL;
+
     m = NdrUnmarshaller[pFormat[0] & NDR_TABLE_MASK];
     if (m) return m(pStubMsg, ppMemory, pFormat, fMustAlloc);
     else
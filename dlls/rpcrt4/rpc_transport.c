@@ -68,6 +68,11 @@ typedef struct _RpcConnection_np
     IO_STATUS_BLOCK io_status;
     HANDLE event_cache;
     BOOL read_closed;
+    /* data of the current message that was read but not consumed yet */
+    char *read_buf;
+    unsigned int read_buf_pos;
+    unsigned int read_buf_len;
+    BOOL read_buf_partial;  /* the message goes on after the buffered data */
 } RpcConnection_np;
 
 static RpcConnection *rpcrt4_conn_np_alloc(void)
@@ -372,9 +377,8 @@ static RPC_STATUS rpcrt4_ncalrpc_handoff(RpcConnection *old_conn, RpcConnection
   return status;
 }
 
-static int rpcrt4_conn_np_read(RpcConnection *conn, void *buffer, unsigned int count)
+static int rpcrt4_conn_np_read_pipe(RpcConnection_np *connection, void *buffer, unsigned int count)
 {
-    RpcConnection_np *connection = (RpcConnection_np *) conn;
     HANDLE event;
     NTSTATUS status;
 
@@ -401,6 +405,53 @@ static int rpcrt4_conn_np_read(RpcConnection *conn, void *buffer, unsigned int c
     return status && status != STATUS_BUFFER_OVERFLOW ? -1 : connection->io_status.Information;
 }
 
+/* Fragments are read as a common header, the rest of the header and the
+ * payload. Fetch as much of the message as fits in the read buffer at once,
+ * so that this takes a single pipe read instead of three. */
+static int rpcrt4_conn_np_read(RpcConnection *conn, void *buffer, unsigned int count)
+{
+    RpcConnection_np *connection = (RpcConnection_np *) conn;
+    unsigned int copied;
+    int len;
+
+    if (connection->read_closed)
+        return -1;
+
+    if (!connection->read_buf_len)
+    {
+        if (!buffer || count >= RPC_MAX_PACKET_SIZE)
+            return rpcrt4_conn_np_read_pipe(connection, buffer, count);
+
+        if (!connection->read_buf &&
+            !(connection->read_buf = HeapAlloc(GetProcessHeap(), 0, RPC_MAX_PACKET_SIZE)))
+            return rpcrt4_conn_np_read_pipe(connection, buffer, count);
+
+        len = rpcrt4_conn_np_read_pipe(connection, connection->read_buf, RPC_MAX_PACKET_SIZE);
+        if (len <= 0) return len;
+        connection->read_buf_pos = 0;
+        connection->read_buf_len = len;
+        connection->read_buf_partial = connection->io_status.Status == STATUS_BUFFER_OVERFLOW;
+    }
+
+    copied = min(count, connection->read_buf_len);
+    if (copied) memcpy(buffer, connection->read_buf + connection->read_buf_pos, copied);
+    connection->read_buf_pos += copied;
+    connection->read_buf_len -= copied;
+
+    /* the message is larger than the buffer (fragments can be bigger than
+     * RPC_MAX_PACKET_SIZE if the peer negotiated it), read the rest directly */
+    if (copied < count && connection->read_buf_partial)
+    {
+        connection->read_buf_partial = FALSE;
+        len = rpcrt4_conn_np_read_pipe(connection, (char *)buffer + copied, count - copied);
+        if (len < 0) return -1;
+        copied += len;
+    }
+    else if (!connection->read_buf_len)
+        connection->read_buf_partial = FALSE;
+    return copied;
+}
+
 static int rpcrt4_conn_np_write(RpcConnection *conn, const void *buffer, unsigned int count)
 {
     RpcConnection_np *connection = (RpcConnection_np *) conn;
@@ -445,6 +496,10 @@ static int rpcrt4_conn_np_close(RpcConnection *conn)
         CloseHandle(connection->event_cache);
         connection->event_cache = 0;
     }
+    HeapFree(GetProcessHeap(), 0, connection->read_buf);
+    connection->read_buf = NULL;
+    connection->read_buf_len = 0;
+    connection->read_buf_partial = FALSE;
     return 0;
 }
 
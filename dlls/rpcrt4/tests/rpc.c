@@ -1244,6 +1244,135 @@ done:
     return hr;
 }
 
+#define LARGE_FRAG_DATA_LEN 0x2000
+
+static const RPC_CLIENT_INTERFACE large_frag_if =
+{
+    sizeof(RPC_CLIENT_INTERFACE),
+    {{0x12345678,0x1234,0x1234,{0x12,0x34,0x56,0x78,0x9a,0xbc,0xde,0xf0}},{1,0}},
+    {{0x8a885d04,0x1ceb,0x11c9,{0x9f,0xe8,0x08,0x00,0x2b,0x10,0x48,0x60}},{2,0}},
+    0, 0, 0, 0, 0,
+};
+
+static void build_common_header(unsigned char *buf, unsigned char ptype, unsigned short frag_len, DWORD call_id)
+{
+    buf[0] = 5;     /* rpc_vers */
+    buf[1] = 0;     /* rpc_vers_minor */
+    buf[2] = ptype;
+    buf[3] = 0x03;  /* PFC_FIRST_FRAG | PFC_LAST_FRAG */
+    buf[4] = 0x10;  /* little endian, ASCII, IEEE */
+    buf[5] = buf[6] = buf[7] = 0;
+    memcpy(buf + 8, &frag_len, sizeof(frag_len));
+    memset(buf + 10, 0, 2); /* auth_len */
+    memcpy(buf + 12, &call_id, sizeof(call_id));
+}
+
+/* a minimal server that answers the first request with a single fragment
+ * larger than the default maximum packet size */
+static DWORD CALLBACK large_frag_server(void *arg)
+{
+    static const char secaddr[] = "\\PIPE\\wine_rpc_large_frag";
+    HANDLE pipe = arg;
+    unsigned char *buf;
+    unsigned short len, frag_len;
+    DWORD size, call_id, i;
+    BOOL ret;
+
+    buf = HeapAlloc(GetProcessHeap(), 0, 0x100 + LARGE_FRAG_DATA_LEN);
+
+    ret = ConnectNamedPipe(pipe, NULL);
+    ok(ret || GetLastError() == ERROR_PIPE_CONNECTED, "ConnectNamedPipe failed %u\n", GetLastError());
+
+    /* bind */
+    ret = ReadFile(pipe, buf, 0x100, &size, NULL);
+    ok(ret, "ReadFile failed %u\n", GetLastError());
+    ok(size >= 16 && buf[2] == 11, "expected a bind packet\n");
+    memcpy(&call_id, buf + 12, sizeof(call_id));
+
+    len = 16;
+    memset(buf + len, 0, 8);
+    buf[len] = 0xd0; buf[len + 1] = 0x16;     /* max_tsize */
+    buf[len + 2] = 0xd0; buf[len + 3] = 0x16; /* max_rsize */
+    buf[len + 4] = 0x78; buf[len + 5] = 0x56; /* assoc_gid */
+    len += 8;
+    size = sizeof(secaddr);
+    buf[len] = size; buf[len + 1] = 0;
+    memcpy(buf + len + 2, secaddr, size);
+    len += (2 + size + 3) & ~3;
+    memset(buf + len, 0, 4);
+    buf[len] = 1;                             /* num_results */
+    len += 4;
+    memset(buf + len, 0, 4);                  /* result, reason: accepted */
+    memcpy(buf + len + 4, &large_frag_if.TransferSyntax, sizeof(large_frag_if.TransferSyntax));
+    len += 4 + sizeof(large_frag_if.TransferSyntax);
+    build_common_header(buf, 12, len, call_id);
+    ret = WriteFile(pipe, buf, len, &size, NULL);
+    ok(ret, "WriteFile failed %u\n", GetLastError());
+
+    /* request */
+    ret = ReadFile(pipe, buf, 0x100, &size, NULL);
+    ok(ret, "ReadFile failed %u\n", GetLastError());
+    ok(size >= 24 && buf[2] == 0, "expected a request packet\n");
+    memcpy(&call_id, buf + 12, sizeof(call_id));
+
+    frag_len = 24 + LARGE_FRAG_DATA_LEN;
+    build_common_header(buf, 2, frag_len, call_id);
+    size = LARGE_FRAG_DATA_LEN;
+    memcpy(buf + 16, &size, sizeof(size));    /* alloc_hint */
+    memset(buf + 20, 0, 4);                   /* context_id, cancel_count */
+    for (i = 0; i < LARGE_FRAG_DATA_LEN; i++) buf[24 + i] = i * 7;
+    ret = WriteFile(pipe, buf, frag_len, &size, NULL);
+    ok(ret, "WriteFile failed %u\n", GetLastError());
+
+    FlushFileBuffers(pipe);
+    DisconnectNamedPipe(pipe);
+    HeapFree(GetProcessHeap(), 0, buf);
+    return 0;
+}
+
+static void test_ncacn_np_large_fragment(void)
+{
+    static unsigned char binding_str[] = "ncacn_np:.[\\pipe\\wine_rpc_large_frag]";
+    RPC_BINDING_HANDLE binding;
+    RPC_MESSAGE msg;
+    RPC_STATUS status;
+    HANDLE pipe, thread;
+    unsigned int i;
+
+    pipe = CreateNamedPipeA("\\\\.\\pipe\\wine_rpc_large_frag", PIPE_ACCESS_DUPLEX,
+                            PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
+                            1, 0x10000, 0x10000, 0, NULL);
+    ok(pipe != INVALID_HANDLE_VALUE, "CreateNamedPipe failed %u\n", GetLastError());
+    thread = CreateThread(NULL, 0, large_frag_server, pipe, 0, NULL);
+
+    status = RpcBindingFromStringBindingA(binding_str, &binding);
+    ok(status == RPC_S_OK, "RpcBindingFromStringBinding failed %u\n", status);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.Handle = binding;
+    msg.RpcInterfaceInformation = (void *)&large_frag_if;
+    msg.BufferLength = 4;
+    status = I_RpcGetBuffer(&msg);
+    ok(status == RPC_S_OK, "I_RpcGetBuffer failed %u\n", status);
+    memset(msg.Buffer, 0, 4);
+
+    status = I_RpcSendReceive(&msg);
+    ok(status == RPC_S_OK, "I_RpcSendReceive failed %u\n", status);
+    if (status == RPC_S_OK)
+    {
+        ok(msg.BufferLength == LARGE_FRAG_DATA_LEN, "got length %u\n", msg.BufferLength);
+        for (i = 0; i < LARGE_FRAG_DATA_LEN; i++)
+            if (((unsigned char *)msg.Buffer)[i] != (unsigned char)(i * 7)) break;
+        ok(i == LARGE_FRAG_DATA_LEN, "data differs at %u\n", i);
+        I_RpcFreeBuffer(&msg);
+    }
+
+    RpcBindingFree(&binding);
+    ok(!WaitForSingleObject(thread, 10000), "server thread didn't finish\n");
+    CloseHandle(thread);
+    CloseHandle(pipe);
+}
+
 START_TEST( rpc )
 {
     static unsigned char ncacn_np[] = "ncacn_np";
@@ -1287,6 +1416,7 @@ START_TEST( rpc )
     test_RpcServerUseProtseq();
     test_endpoint_mapper(ncacn_np, np_address);
     test_endpoint_mapper(ncalrpc, NULL);
+    test_ncacn_np_large_fragment();
 
     if (firewall_enabled) set_firewall(APP_REMOVE);
 }
@@ -30,6 +30,12 @@
 
 #include "tomcrypt.h"
 
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#include <intrin.h>
+#define USE_AESNI
+#endif
+
 static const ulong32 TE0[256] = {
     0xc66363a5UL, 0xf87c7c84UL, 0xee777799UL, 0xf67b7b8dUL,
     0xfff2f20dUL, 0xd66b6bbdUL, 0xde6f6fb1UL, 0x91c5c554UL,
@@ -926,6 +932,52 @@ static const ulong32 rcon[] = {
     0x1B000000UL, 0x36000000UL
 };
 
+#ifdef USE_AESNI
+
+static int aesni_supported(void)
+{
+    static int supported = -1;
+    int regs[4];
+
+    if (supported == -1) {
+        __cpuid(regs, 1);
+        supported = (regs[2] >> 25) & 1;
+    }
+    return supported;
+}
+
+/* The AES instructions use the same round keys as the table driven code,
+ * including the equivalent inverse cipher keys for decryption, in byte order. */
+static void __attribute__((__target__("aes"))) aesni_ecb_encrypt(const unsigned char *pt, unsigned char *ct,
+                                                                 const aes_key *skey)
+{
+    const __m128i *rk = (const __m128i *)skey->ni_eK;
+    __m128i block;
+    int r;
+
+    block = _mm_xor_si128(_mm_loadu_si128((const __m128i *)pt), _mm_loadu_si128(rk));
+    for (r = 1; r < skey->Nr; r++)
+        block = _mm_aesenc_si128(block, _mm_loadu_si128(rk + r));
+    block = _mm_aesenclast_si128(block, _mm_loadu_si128(rk + skey->Nr));
+    _mm_storeu_si128((__m128i *)ct, block);
+}
+
+static void __attribute__((__target__("aes"))) aesni_ecb_decrypt(const unsigned char *ct, unsigned char *pt,
+                                                                 const aes_key *skey)
+{
+    const __m128i *rk = (const __m128i *)skey->ni_dK;
+    __m128i block;
+    int r;
+
+    block = _mm_xor_si128(_mm_loadu_si128((const __m128i *)ct), _mm_loadu_si128(rk));
+    for (r = 1; r < skey->Nr; r++)
+        block = _mm_aesdec_si128(block, _mm_loadu_si128(rk + r));
+    block = _mm_aesdeclast_si128(block, _mm_loadu_si128(rk + skey->Nr));
+    _mm_storeu_si128((__m128i *)pt, block);
+}
+
+#endif
+
 static ulong32 setup_mix(ulong32 temp)
 {
    return (Te4_3[byte(temp, 2)]) ^
@@ -1058,6 +1110,17 @@ int aes_setup(const unsigned char *key, int keylen, int rounds, aes_key *skey)
     *rk++ = *rrk++;
     *rk   = *rrk;
 
+    skey->ni = 0;
+#ifdef USE_AESNI
+    if (aesni_supported()) {
+        for (i = 0; i < 4 * (skey->Nr + 1); i++) {
+            STORE32H(skey->eK[i], skey->ni_eK + 4 * i);
+            STORE32H(skey->dK[i], skey->ni_dK + 4 * i);
+        }
+        skey->ni = 1;
+    }
+#endif
+
     return CRYPT_OK;
 }
 
@@ -1066,6 +1129,13 @@ void aes_ecb_encrypt(const unsigned char *pt, unsigned char *ct, aes_key *skey)
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
 
+#ifdef USE_AESNI
+    if (skey->ni) {
+        aesni_ecb_encrypt(pt, ct, skey);
+        return;
+    }
+#endif
+
     Nr = skey->Nr;
     rk = skey->eK;
 
@@ -1167,6 +1237,13 @@ void aes_ecb_decrypt(const unsigned char *ct, unsigned char *pt, aes_key *skey)
     ulong32 s0, s1, s2, s3, t0, t1, t2, t3, *rk;
     int Nr, r;
 
+#ifdef USE_AESNI
+    if (skey->ni) {
+        aesni_ecb_decrypt(ct, pt, skey);
+        return;
+    }
+#endif
+
     Nr = skey->Nr;
     rk = skey->dK;
 
@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <dlfcn.h>
 #ifdef SONAME_LIBGNUTLS
@@ -47,6 +48,7 @@
 
 #include "wine/unixlib.h"
 #include "wine/debug.h"
+#include "wine/list.h"
 
 #if defined(SONAME_LIBGNUTLS)
 
@@ -76,6 +78,9 @@ static int (*pgnutls_privkey_import_rsa_raw)(gnutls_privkey_t, const gnutls_datu
 /* Not present in gnutls version < 3.4.0. */
 static int (*pgnutls_privkey_export_x509)(gnutls_privkey_t, gnutls_x509_privkey_t *);
 
+/* Not present in gnutls version < 3.5.0. */
+static unsigned int (*pgnutls_session_get_flags)(gnutls_session_t);
+
 static void *libgnutls_handle;
 #define MAKE_FUNCPTR(f) static typeof(f) * p##f
 MAKE_FUNCPTR(gnutls_alert_get);
@@ -107,6 +112,11 @@ MAKE_FUNCPTR(gnutls_record_recv);
 MAKE_FUNCPTR(gnutls_record_send);
 MAKE_FUNCPTR(gnutls_server_name_set);
 MAKE_FUNCPTR(gnutls_session_channel_binding);
+MAKE_FUNCPTR(gnutls_session_get_data);
+MAKE_FUNCPTR(gnutls_session_get_ptr);
+MAKE_FUNCPTR(gnutls_session_is_resumed);
+MAKE_FUNCPTR(gnutls_session_set_data);
+MAKE_FUNCPTR(gnutls_session_set_ptr);
 MAKE_FUNCPTR(gnutls_transport_get_ptr);
 MAKE_FUNCPTR(gnutls_transport_set_errno);
 MAKE_FUNCPTR(gnutls_transport_set_ptr);
@@ -135,6 +145,11 @@ MAKE_FUNCPTR(gnutls_x509_privkey_deinit);
 #define GNUTLS_ALPN_SERVER_PRECEDENCE (1<<1)
 #endif
 
+#if GNUTLS_VERSION_MAJOR < 3 || (GNUTLS_VERSION_MAJOR == 3 && GNUTLS_VERSION_MINOR < 6)
+#define GNUTLS_TLS1_3 5
+#define GNUTLS_SFLAGS_SESSION_TICKET (1<<7)
+#endif
+
 static int compat_cipher_get_block_size(gnutls_cipher_algorithm_t cipher)
 {
     switch(cipher) {
@@ -198,6 +213,11 @@ static void compat_gnutls_dtls_set_mtu(gnutls_session_t session, unsigned int mt
     FIXME("\n");
 }
 
+static unsigned int compat_gnutls_session_get_flags(gnutls_session_t session)
+{
+    return 0;
+}
+
 static void init_schan_buffers(struct schan_buffers *s, const PSecBufferDesc desc,
         int (*get_next_buffer)(const struct schan_transport *, struct schan_buffers *))
 {
@@ -537,10 +557,117 @@ static NTSTATUS schan_create_session( void *args )
     return STATUS_SUCCESS;
 }
 
+/* Client sessions are cached by target name and credentials, so that later
+ * connections to the same server can resume them with an abbreviated handshake. */
+#define SESSION_CACHE_SIZE 64
+
+struct session_cache_entry
+{
+    struct list entry;
+    gnutls_certificate_credentials_t credentials;
+    void *data;
+    size_t size;
+    char target[1];
+};
+
+/* attached to client sessions which have a target */
+struct session_target
+{
+    gnutls_certificate_credentials_t credentials;
+    BOOL stored;
+    char name[1];
+};
+
+static struct list session_cache = LIST_INIT( session_cache );
+static unsigned int session_cache_count;
+static unsigned int full_handshakes, resumed_handshakes;
+static pthread_mutex_t session_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* session_cache_mutex must be held */
+static struct session_cache_entry *find_cached_session( gnutls_certificate_credentials_t credentials,
+                                                        const char *target )
+{
+    struct session_cache_entry *entry;
+
+    LIST_FOR_EACH_ENTRY( entry, &session_cache, struct session_cache_entry, entry )
+        if (entry->credentials == credentials && !strcmp( entry->target, target )) return entry;
+    return NULL;
+}
+
+/* session_cache_mutex must be held */
+static void free_cached_session( struct session_cache_entry *entry )
+{
+    list_remove( &entry->entry );
+    session_cache_count--;
+    free( entry->data );
+    free( entry );
+}
+
+static void resume_session( gnutls_session_t s, const struct session_target *target )
+{
+    struct session_cache_entry *entry;
+    int err;
+
+    pthread_mutex_lock( &session_cache_mutex );
+    if ((entry = find_cached_session( target->credentials, target->name )))
+    {
+        TRACE( "resuming session for %s\n", debugstr_a(target->name) );
+        if ((err = pgnutls_session_set_data( s, entry->data, entry->size )) != GNUTLS_E_SUCCESS)
+        {
+            pgnutls_perror( err );
+            free_cached_session( entry );
+        }
+    }
+    pthread_mutex_unlock( &session_cache_mutex );
+}
+
+static void store_session( gnutls_session_t s, struct session_target *target )
+{
+    struct session_cache_entry *entry, *old;
+    size_t len = strlen( target->name ), size = 0;
+
+    /* TLS 1.3 sessions can only be resumed once the server has sent a ticket */
+    if (pgnutls_protocol_get_version( s ) == GNUTLS_TLS1_3 &&
+        !(pgnutls_session_get_flags( s ) & GNUTLS_SFLAGS_SESSION_TICKET))
+        return;
+
+    target->stored = TRUE;
+    if (pgnutls_session_get_data( s, NULL, &size ) != GNUTLS_E_SUCCESS || !size) return;
+    if (!(entry = malloc( offsetof( struct session_cache_entry, target[len + 1] ) ))) return;
+    if (!(entry->data = malloc( size )) || pgnutls_session_get_data( s, entry->data, &size ) != GNUTLS_E_SUCCESS)
+    {
+        free( entry->data );
+        free( entry );
+        return;
+    }
+    entry->size = size;
+    entry->credentials = target->credentials;
+    memcpy( entry->target, target->name, len + 1 );
+
+    pthread_mutex_lock( &session_cache_mutex );
+    if ((old = find_cached_session( target->credentials, target->name ))) free_cached_session( old );
+    else if (session_cache_count == SESSION_CACHE_SIZE)
+        free_cached_session( LIST_ENTRY( list_tail( &session_cache ), struct session_cache_entry, entry ) );
+    list_add_head( &session_cache, &entry->entry );
+    session_cache_count++;
+    pthread_mutex_unlock( &session_cache_mutex );
+}
+
+static void flush_session_cache( gnutls_certificate_credentials_t credentials )
+{
+    struct session_cache_entry *entry, *next;
+
+    pthread_mutex_lock( &session_cache_mutex );
+    LIST_FOR_EACH_ENTRY_SAFE( entry, next, &session_cache, struct session_cache_entry, entry )
+        if (!credentials || entry->credentials == credentials) free_cached_session( entry );
+    pthread_mutex_unlock( &session_cache_mutex );
+}
+
 static NTSTATUS schan_dispose_session( void *args )
 {
     const struct session_params *params = args;
     gnutls_session_t s = (gnutls_session_t)params->session;
+    free(pgnutls_session_get_ptr(s));
     pgnutls_deinit(s);
     return STATUS_SUCCESS;
 }
@@ -549,7 +676,20 @@ static NTSTATUS schan_set_session_target( void *args )
 {
     const struct set_session_target_params *params = args;
     gnutls_session_t s = (gnutls_session_t)params->session;
-    pgnutls_server_name_set( s, GNUTLS_NAME_DNS, params->target, strlen(params->target) );
+    size_t len = strlen( params->target );
+    struct session_target *target;
+
+    pgnutls_server_name_set( s, GNUTLS_NAME_DNS, params->target, len );
+
+    if (params->cred->credential_use == SECPKG_CRED_INBOUND) return STATUS_SUCCESS;
+    if (!(target = malloc( offsetof( struct session_target, name[len + 1] ) ))) return STATUS_SUCCESS;
+    target->credentials = params->cred->credentials;
+    target->stored = FALSE;
+    memcpy( target->name, params->target, len + 1 );
+    free( pgnutls_session_get_ptr( s ) );
+    pgnutls_session_set_ptr( s, target );
+
+    resume_session( s, target );
     return STATUS_SUCCESS;
 }
 
@@ -569,8 +709,21 @@ static NTSTATUS schan_handshake( void *args )
         err = pgnutls_handshake(s);
         switch(err) {
         case GNUTLS_E_SUCCESS:
+        {
+            struct session_target *target = pgnutls_session_get_ptr(s);
+
             TRACE("Handshake completed\n");
+            if (target)
+            {
+                pthread_mutex_lock(&session_cache_mutex);
+                if (pgnutls_session_is_resumed(s)) resumed_handshakes++;
+                else full_handshakes++;
+                TRACE("resumed %u of %u handshakes\n", resumed_handshakes, resumed_handshakes + full_handshakes);
+                pthread_mutex_unlock(&session_cache_mutex);
+                store_session(s, target);
+            }
             return SEC_E_OK;
+        }
 
         case GNUTLS_E_AGAIN:
             TRACE("Continue...\n");
@@ -892,6 +1045,13 @@ static NTSTATUS schan_recv( void *args )
         }
     }
 
+    /* TLS 1.3 session tickets are sent after the handshake */
+    if (received)
+    {
+        struct session_target *target = pgnutls_session_get_ptr(s);
+        if (target && !target->stored) store_session(s, target);
+    }
+
     *params->length = received;
     return status;
 }
@@ -1142,6 +1302,7 @@ static NTSTATUS schan_allocate_certificate_credentials( void *args )
 static NTSTATUS schan_free_certificate_credentials( void *args )
 {
     const struct free_certificate_credentials_params *params = args;
+    flush_session_cache(params->c->credentials);
     pgnutls_certificate_free_credentials(params->c->credentials);
     return STATUS_SUCCESS;
 }
@@ -1209,6 +1370,11 @@ static NTSTATUS process_attach( void *args )
     LOAD_FUNCPTR(gnutls_record_send);
     LOAD_FUNCPTR(gnutls_server_name_set)
     LOAD_FUNCPTR(gnutls_session_channel_binding)
+    LOAD_FUNCPTR(gnutls_session_get_data)
+    LOAD_FUNCPTR(gnutls_session_get_ptr)
+    LOAD_FUNCPTR(gnutls_session_is_resumed)
+    LOAD_FUNCPTR(gnutls_session_set_data)
+    LOAD_FUNCPTR(gnutls_session_set_ptr)
     LOAD_FUNCPTR(gnutls_transport_get_ptr)
     LOAD_FUNCPTR(gnutls_transport_set_errno)
     LOAD_FUNCPTR(gnutls_transport_set_ptr)
@@ -1255,6 +1421,11 @@ static NTSTATUS process_attach( void *args )
         WARN("gnutls_privkey_import_rsa_raw not found\n");
         pgnutls_privkey_import_rsa_raw = compat_gnutls_privkey_import_rsa_raw;
     }
+    if (!(pgnutls_session_get_flags = dlsym(libgnutls_handle, "gnutls_session_get_flags")))
+    {
+        WARN("gnutls_session_get_flags not found\n");
+        pgnutls_session_get_flags = compat_gnutls_session_get_flags;
+    }
 
     ret = pgnutls_global_init();
     if (ret != GNUTLS_E_SUCCESS)
@@ -1280,6 +1451,7 @@ fail:
 
 static NTSTATUS process_detach( void *args )
 {
+    flush_session_cache(NULL);
     pgnutls_global_deinit();
     dlclose(libgnutls_handle);
     libgnutls_handle = NULL;
@@ -200,6 +200,7 @@ struct set_dtls_mtu_params
 struct set_session_target_params
 {
     schan_session session;
+    schan_credentials *cred;
     const char *target;
 };
 
@@ -44,6 +44,7 @@ static HMODULE vcomp_module;
 static int     vcomp_max_threads;
 static int     vcomp_num_threads;
 static int     vcomp_num_procs;
+static unsigned int vcomp_spin_count;
 static BOOL    vcomp_nested_fork = FALSE;
 
 static RTL_CRITICAL_SECTION vcomp_section;
@@ -60,6 +61,12 @@ static RTL_CRITICAL_SECTION vcomp_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 #define VCOMP_DYNAMIC_FLAGS_GUIDED      0x03
 #define VCOMP_DYNAMIC_FLAGS_INCREMENT   0x40
 
+/* number of iterations to spin before blocking on a barrier or an idle worker */
+#define VCOMP_SPIN_COUNT                4000
+
+/* work sharing state: generation of the construct in the high, claimed items in the low 32 bits */
+#define VCOMP_WORK_STATE(generation, claimed) (((LONG64)(generation) << 32) | (unsigned int)(claimed))
+
 struct vcomp_thread_data
 {
     struct vcomp_team_data  *team;
@@ -77,19 +84,24 @@ struct vcomp_thread_data
 
     /* section */
     unsigned int            section;
+    int                     num_sections;
 
     /* dynamic */
     unsigned int            dynamic;
     unsigned int            dynamic_type;
     unsigned int            dynamic_begin;
     unsigned int            dynamic_end;
+    unsigned int            dynamic_first;
+    unsigned int            dynamic_last;
+    unsigned int            dynamic_iterations;
+    int                     dynamic_step;
+    unsigned int            dynamic_chunksize;
 };
 
 struct vcomp_team_data
 {
-    CONDITION_VARIABLE      cond;
     int                     num_threads;
-    int                     finished_threads;
+    LONG                    finished_threads;
 
     /* callback arguments */
     int                     nargs;
@@ -97,27 +109,21 @@ struct vcomp_team_data
     va_list                 valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    LONG                    barrier;
+    LONG                    barrier_count;
 };
 
+/* shared by the team, only updated with interlocked operations */
 struct vcomp_task_data
 {
     /* single */
-    unsigned int            single;
+    LONG                    single;
 
     /* section */
-    unsigned int            section;
-    int                     num_sections;
-    int                     section_index;
+    LONG64                  section;
 
     /* dynamic */
-    unsigned int            dynamic;
-    unsigned int            dynamic_first;
-    unsigned int            dynamic_last;
-    unsigned int            dynamic_iterations;
-    int                     dynamic_step;
-    unsigned int            dynamic_chunksize;
+    LONG64                  dynamic;
 };
 
 static void **ptr_from_va_list(va_list valist)
@@ -436,6 +442,55 @@ static void vcomp_free_thread_data(void)
     vcomp_set_thread_data(NULL);
 }
 
+/* spin for a while, then block until *ptr no longer has the given value */
+static void vcomp_wait_while_equal(LONG *ptr, LONG value)
+{
+    unsigned int spin;
+
+    for (spin = 0; spin < vcomp_spin_count; spin++)
+    {
+        if (*(volatile LONG *)ptr != value) return;
+        YieldProcessor();
+    }
+    while (*(volatile LONG *)ptr == value)
+        RtlWaitOnAddress(ptr, &value, sizeof(value), NULL);
+}
+
+/* claim the next items of a work sharing construct, the first thread arriving
+ * starts the construct; returns the number of items claimed */
+static unsigned int vcomp_claim_work(LONG64 *state, unsigned int generation, unsigned int total,
+                                     unsigned int chunksize, int guided_threads, unsigned int *first)
+{
+    unsigned int current, claimed, remaining, count;
+    LONG64 old;
+
+    for (;;)
+    {
+        old = *(volatile LONG64 *)state;
+        current = old >> 32;
+        claimed = (unsigned int)old;
+
+        if (current != generation)
+        {
+            /* a later construct was already started, so this one is finished */
+            if ((int)(generation - current) < 0) return 0;
+            InterlockedCompareExchange64(state, VCOMP_WORK_STATE(generation, 0), old);
+            continue;
+        }
+
+        if (!(remaining = total - claimed)) return 0;
+        count = min(remaining, chunksize);
+        if (guided_threads && remaining > guided_threads * chunksize)
+            count = (remaining + guided_threads - 1) / guided_threads;
+
+        if (InterlockedCompareExchange64(state, VCOMP_WORK_STATE(generation, claimed + count), old) == old)
+        {
+            *first = claimed;
+            return count;
+        }
+    }
+}
+
 void CDECL _vcomp_atomic_add_i1(char *dest, char val)
 {
     interlocked_xchg_add8(dest, val);
@@ -1057,26 +1112,22 @@ void CDECL _vcomp_flush(void)
 void CDECL _vcomp_barrier(void)
 {
     struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    LONG barrier;
 
     TRACE("()\n");
 
     if (!team_data)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
+    barrier = team_data->barrier;
+    if (InterlockedIncrement(&team_data->barrier_count) >= team_data->num_threads)
     {
-        team_data->barrier++;
+        /* reset the count before releasing the other threads, they may enter the next barrier right away */
         team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
+        InterlockedIncrement(&team_data->barrier);
+        RtlWakeAddressAll(&team_data->barrier);
     }
-    else
-    {
-        unsigned int barrier = team_data->barrier;
-        while (team_data->barrier == barrier)
-            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
-    }
-    LeaveCriticalSection(&vcomp_section);
+    else vcomp_wait_while_equal(&team_data->barrier, barrier);
 }
 
 void CDECL _vcomp_set_num_threads(int num_threads)
@@ -1102,20 +1153,18 @@ int CDECL _vcomp_single_begin(int flags)
 {
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
     struct vcomp_task_data *task_data = thread_data->task;
-    int ret = FALSE;
+    LONG single;
 
     TRACE("(%x): semi-stub\n", flags);
 
-    EnterCriticalSection(&vcomp_section);
     thread_data->single++;
-    if ((int)(thread_data->single - task_data->single) > 0)
+    for (;;)
     {
-        task_data->single = thread_data->single;
-        ret = TRUE;
+        single = *(volatile LONG *)&task_data->single;
+        if ((int)(thread_data->single - single) <= 0) return FALSE;
+        if (InterlockedCompareExchange(&task_data->single, thread_data->single, single) == single)
+            return TRUE;
     }
-    LeaveCriticalSection(&vcomp_section);
-
-    return ret;
 }
 
 void CDECL _vcomp_single_end(void)
@@ -1127,36 +1176,23 @@ void CDECL _vcomp_single_end(void)
 void CDECL _vcomp_sections_init(int n)
 {
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
-    struct vcomp_task_data *task_data = thread_data->task;
 
     TRACE("(%d)\n", n);
 
-    EnterCriticalSection(&vcomp_section);
     thread_data->section++;
-    if ((int)(thread_data->section - task_data->section) > 0)
-    {
-        task_data->section       = thread_data->section;
-        task_data->num_sections  = n;
-        task_data->section_index = 0;
-    }
-    LeaveCriticalSection(&vcomp_section);
+    thread_data->num_sections = max(n, 0);
 }
 
 int CDECL _vcomp_sections_next(void)
 {
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
     struct vcomp_task_data *task_data = thread_data->task;
-    int i = -1;
+    unsigned int i;
 
     TRACE("()\n");
 
-    EnterCriticalSection(&vcomp_section);
-    if (thread_data->section == task_data->section &&
-        task_data->section_index != task_data->num_sections)
-    {
-        i = task_data->section_index++;
-    }
-    LeaveCriticalSection(&vcomp_section);
+    if (!vcomp_claim_work(&task_data->section, thread_data->section, thread_data->num_sections, 1, 0, &i))
+        return -1;
     return i;
 }
 
@@ -1418,7 +1454,6 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
     unsigned int iterations, per_thread, remaining;
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
     struct vcomp_team_data *team_data = thread_data->team;
-    struct vcomp_task_data *task_data = thread_data->task;
     int num_threads = team_data ? team_data->num_threads : 1;
     int thread_num = thread_data->thread_num;
     unsigned int type = flags & ~VCOMP_DYNAMIC_FLAGS_INCREMENT;
@@ -1467,19 +1502,14 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
             type = VCOMP_DYNAMIC_FLAGS_GUIDED;
         }
 
-        EnterCriticalSection(&vcomp_section);
+        /* all threads of the team see the same loop, only the iteration count is shared */
         thread_data->dynamic++;
-        thread_data->dynamic_type = type;
-        if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
-        {
-            task_data->dynamic              = thread_data->dynamic;
-            task_data->dynamic_first        = first;
-            task_data->dynamic_last         = last;
-            task_data->dynamic_iterations   = iterations;
-            task_data->dynamic_step         = step;
-            task_data->dynamic_chunksize    = chunksize;
-        }
-        LeaveCriticalSection(&vcomp_section);
+        thread_data->dynamic_type       = type;
+        thread_data->dynamic_first      = first;
+        thread_data->dynamic_last       = last;
+        thread_data->dynamic_iterations = iterations;
+        thread_data->dynamic_step       = step;
+        thread_data->dynamic_chunksize  = chunksize;
     }
 }
 
@@ -1502,26 +1532,20 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
     else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
              thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
-        unsigned int iterations = 0;
-        EnterCriticalSection(&vcomp_section);
-        if (thread_data->dynamic == task_data->dynamic &&
-            task_data->dynamic_iterations != 0)
-        {
-            iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
-            if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
-                task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
-            {
-                iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
-            }
-            *begin = task_data->dynamic_first;
-            *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
-            task_data->dynamic_iterations -= iterations;
-            task_data->dynamic_first      += iterations * task_data->dynamic_step;
-            if (!task_data->dynamic_iterations)
-                *end = task_data->dynamic_last;
-        }
-        LeaveCriticalSection(&vcomp_section);
-        return iterations != 0;
+        unsigned int iterations, first;
+
+        iterations = vcomp_claim_work(&task_data->dynamic, thread_data->dynamic,
+                                      thread_data->dynamic_iterations, thread_data->dynamic_chunksize,
+                                      thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED ? num_threads : 0,
+                                      &first);
+        if (!iterations) return 0;
+
+        *begin = thread_data->dynamic_first + first * thread_data->dynamic_step;
+        if (first + iterations == thread_data->dynamic_iterations)
+            *end = thread_data->dynamic_last;
+        else
+            *end = *begin + (iterations - 1) * thread_data->dynamic_step;
+        return 1;
     }
 
     return 0;
@@ -1546,6 +1570,9 @@ static DWORD WINAPI _vcomp_fork_worker(void *param)
         struct vcomp_team_data *team = thread_data->team;
         if (team != NULL)
         {
+            int num_threads = team->num_threads;
+            unsigned int spin;
+
             LeaveCriticalSection(&vcomp_section);
             _vcomp_fork_call_wrapper(team->wrapper, team->nargs, ptr_from_va_list(team->valist));
             EnterCriticalSection(&vcomp_section);
@@ -1553,8 +1580,21 @@ static DWORD WINAPI _vcomp_fork_worker(void *param)
             thread_data->team = NULL;
             list_remove(&thread_data->entry);
             list_add_tail(&vcomp_idle_threads, &thread_data->entry);
-            if (++team->finished_threads >= team->num_threads)
-                WakeAllConditionVariable(&team->cond);
+            LeaveCriticalSection(&vcomp_section);
+
+            /* the master may return right after the increment, the wake only uses the address */
+            if (InterlockedIncrement(&team->finished_threads) >= num_threads)
+                RtlWakeAddressAll(&team->finished_threads);
+
+            /* stay hot for a while, parallel regions usually follow each other closely */
+            for (spin = 0; spin < vcomp_spin_count; spin++)
+            {
+                if (*(struct vcomp_team_data * volatile *)&thread_data->team) break;
+                YieldProcessor();
+            }
+
+            EnterCriticalSection(&vcomp_section);
+            if (thread_data->team) continue;
         }
 
         if (!SleepConditionVariableCS(&thread_data->cond, &vcomp_section, 5000) &&
@@ -1594,7 +1634,6 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     else
         num_threads = vcomp_num_threads;
 
-    InitializeConditionVariable(&team_data.cond);
     team_data.num_threads       = 1;
     team_data.finished_threads  = 0;
     team_data.nargs             = nargs;
@@ -1687,13 +1726,13 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
 
     if (team_data.num_threads > 1)
     {
-        EnterCriticalSection(&vcomp_section);
-
-        team_data.finished_threads++;
-        while (team_data.finished_threads < team_data.num_threads)
-            SleepConditionVariableCS(&team_data.cond, &vcomp_section, INFINITE);
+        LONG finished = InterlockedIncrement(&team_data.finished_threads);
 
-        LeaveCriticalSection(&vcomp_section);
+        while (finished < team_data.num_threads)
+        {
+            vcomp_wait_while_equal(&team_data.finished_threads, finished);
+            finished = *(volatile LONG *)&team_data.finished_threads;
+        }
         assert(list_empty(&thread_data.entry));
     }
 
@@ -1970,6 +2009,7 @@ BOOL WINAPI DllMain(HINSTANCE instance, DWORD reason, LPVOID reserved)
             vcomp_max_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_threads = sysinfo.dwNumberOfProcessors;
             vcomp_num_procs   = sysinfo.dwNumberOfProcessors;
+            vcomp_spin_count  = vcomp_num_procs > 1 ? VCOMP_SPIN_COUNT : 0;
             break;
         }
 
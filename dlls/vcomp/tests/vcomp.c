@@ -1725,6 +1725,48 @@ static void test_vcomp_for_dynamic_init(void)
     pomp_set_num_threads(max_threads);
 }
 
+static void CDECL barrier_cb(LONG *arrived, LONG *counts)
+{
+    int num_threads = pomp_get_num_threads();
+    unsigned int begin, end, i;
+    int round;
+
+    for (round = 0; round < 100; round++)
+    {
+        /* all threads must reach the barrier after each dynamic loop */
+        p_vcomp_for_dynamic_init(VCOMP_DYNAMIC_FLAGS_CHUNKED | VCOMP_DYNAMIC_FLAGS_INCREMENT, 0, 99, 1, 3);
+        while (p_vcomp_for_dynamic_next(&begin, &end))
+            for (i = begin; i <= end; i++) InterlockedIncrement(&counts[i]);
+
+        InterlockedIncrement(arrived);
+        p_vcomp_barrier();
+        /* and agree on the number of arrivals before the next round */
+        ok(*arrived == (round + 1) * num_threads, "round %d: expected %d, got %d\n",
+           round, (round + 1) * num_threads, *arrived);
+        p_vcomp_barrier();
+    }
+}
+
+static void test_vcomp_barrier(void)
+{
+    int max_threads = pomp_get_max_threads();
+    LONG arrived, counts[100];
+    int i, j;
+
+    for (i = 1; i <= 4; i++)
+    {
+        pomp_set_num_threads(i);
+
+        arrived = 0;
+        memset(counts, 0, sizeof(counts));
+        p_vcomp_fork(TRUE, 2, barrier_cb, &arrived, counts);
+        for (j = 0; j < ARRAY_SIZE(counts); j++)
+            ok(counts[j] == 100, "%d threads: iteration %d ran %d times\n", i, j, counts[j]);
+    }
+
+    pomp_set_num_threads(max_threads);
+}
+
 static void CDECL master_cb(HANDLE semaphore)
 {
     int num_threads = pomp_get_num_threads();
@@ -2644,6 +2686,7 @@ START_TEST(vcomp)
     test_vcomp_for_static_simple_init();
     test_vcomp_for_static_init();
     test_vcomp_for_dynamic_init();
+    test_vcomp_barrier();
     test_vcomp_master_begin();
     test_vcomp_single_begin();
     test_vcomp_enter_critsect();
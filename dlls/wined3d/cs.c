@@ -20,6 +20,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(d3d_sync);
 WINE_DECLARE_DEBUG_CHANNEL(fps);
 
@@ -3217,6 +3218,7 @@ static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct
 static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined3d_cs *cs)
 {
     struct wined3d_cs_packet *packet;
+    unsigned int occupancy;
     size_t packet_size;
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
@@ -3224,6 +3226,12 @@ static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
     InterlockedExchange(&queue->head, (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
 
+    ++queue->stats.packet_count;
+    queue->stats.byte_count += packet_size;
+    occupancy = (queue->head - *(volatile LONG *)&queue->tail) & (WINED3D_CS_QUEUE_SIZE - 1);
+    if (occupancy > queue->stats.max_occupancy)
+        queue->stats.max_occupancy = occupancy;
+
     if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         SetEvent(cs->event);
 }
@@ -3238,11 +3246,44 @@ static void wined3d_cs_mt_submit(struct wined3d_device_context *context, enum wi
     wined3d_cs_queue_submit(&cs->queue[queue_id], cs);
 }
 
+/* Waits for the CS thread to make progress on "queue". We spin briefly
+ * first, and then block until the CS thread signals us, using a timeout in
+ * case it exits without doing so. The producer's spin budget is much smaller
+ * than the CS thread's, since it would otherwise burn a core for as long as
+ * the CS thread takes to execute the queued commands. */
+static void wined3d_cs_queue_wait(struct wined3d_cs *cs, const struct wined3d_cs_queue *queue,
+        LONG tail, unsigned int *spin_count)
+{
+    if (*spin_count < WINED3D_CS_PRODUCER_SPIN_COUNT)
+    {
+        ++*spin_count;
+        YieldProcessor();
+        return;
+    }
+
+    InterlockedExchange(&cs->producer_waiting, TRUE);
+    /* The CS thread may have moved the tail before "producer_waiting" was set. */
+    if (*(volatile LONG *)&queue->tail == tail)
+        WaitForSingleObject(cs->producer_event, WINED3D_CS_WAIT_TIMEOUT);
+    InterlockedExchange(&cs->producer_waiting, FALSE);
+}
+
+static void wined3d_cs_queue_add_wait_time(struct wined3d_cs_queue *queue, const LARGE_INTEGER *start)
+{
+    LARGE_INTEGER end;
+
+    QueryPerformanceCounter(&end);
+    queue->stats.wait_time += end.QuadPart - start->QuadPart;
+}
+
 static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size_t size, struct wined3d_cs *cs)
 {
     size_t queue_size = ARRAY_SIZE(queue->data);
     size_t header_size, packet_size, remaining;
     struct wined3d_cs_packet *packet;
+    unsigned int spin_count = 0;
+    BOOL waited = FALSE;
+    LARGE_INTEGER start;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
@@ -3293,7 +3334,16 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
+        if (!waited)
+        {
+            QueryPerformanceCounter(&start);
+            ++queue->stats.space_wait_count;
+            waited = TRUE;
+        }
+        wined3d_cs_queue_wait(cs, queue, tail, &spin_count);
     }
+    if (waited)
+        wined3d_cs_queue_add_wait_time(queue, &start);
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
     packet->size = size;
@@ -3314,12 +3364,24 @@ static void *wined3d_cs_mt_require_space(struct wined3d_device_context *context,
 static void wined3d_cs_mt_finish(struct wined3d_device_context *context, enum wined3d_cs_queue_id queue_id)
 {
     struct wined3d_cs *cs = wined3d_cs_from_context(context);
+    struct wined3d_cs_queue *queue = &cs->queue[queue_id];
+    unsigned int spin_count = 0;
+    LARGE_INTEGER start;
+    LONG tail;
 
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(context, queue_id);
 
-    while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
-        YieldProcessor();
+    if (queue->head == (tail = *(volatile LONG *)&queue->tail))
+        return;
+
+    QueryPerformanceCounter(&start);
+    ++queue->stats.finish_wait_count;
+    do
+    {
+        wined3d_cs_queue_wait(cs, queue, tail, &spin_count);
+    } while (queue->head != (tail = *(volatile LONG *)&queue->tail));
+    wined3d_cs_queue_add_wait_time(queue, &start);
 }
 
 static const struct wined3d_device_context_ops wined3d_cs_mt_ops =
@@ -3420,7 +3482,7 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
-                if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
+                if (++spin_count >= wined3d_settings.cs_spin_count && list_empty(&cs->query_poll_list))
                     wined3d_cs_wait_event(cs);
                 continue;
             }
@@ -3449,6 +3511,10 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
 
         tail &= (WINED3D_CS_QUEUE_SIZE - 1);
         InterlockedExchange(&queue->tail, tail);
+
+        if (*(volatile LONG *)&cs->producer_waiting
+                && InterlockedCompareExchange(&cs->producer_waiting, FALSE, TRUE))
+            SetEvent(cs->producer_event);
     }
 
     cs->queue[WINED3D_CS_QUEUE_MAP].tail = cs->queue[WINED3D_CS_QUEUE_MAP].head;
@@ -3497,10 +3563,19 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
             goto fail;
         }
 
+        if (!(cs->producer_event = CreateEventW(NULL, FALSE, FALSE, NULL)))
+        {
+            ERR("Failed to create command stream producer event.\n");
+            CloseHandle(cs->event);
+            heap_free(cs->data);
+            goto fail;
+        }
+
         if (!(GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
                 (const WCHAR *)wined3d_cs_run, &cs->wined3d_module)))
         {
             ERR("Failed to get wined3d module handle.\n");
+            CloseHandle(cs->producer_event);
             CloseHandle(cs->event);
             heap_free(cs->data);
             goto fail;
@@ -3510,6 +3585,7 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device,
         {
             ERR("Failed to create wined3d command stream thread.\n");
             FreeLibrary(cs->wined3d_module);
+            CloseHandle(cs->producer_event);
             CloseHandle(cs->event);
             heap_free(cs->data);
             goto fail;
@@ -3525,6 +3601,24 @@ fail:
     return NULL;
 }
 
+static void wined3d_cs_dump_queue_stats(const struct wined3d_cs *cs)
+{
+    const struct wined3d_cs_queue_stats *stats;
+    LARGE_INTEGER frequency;
+    unsigned int i;
+
+    QueryPerformanceFrequency(&frequency);
+    for (i = 0; i < ARRAY_SIZE(cs->queue); ++i)
+    {
+        stats = &cs->queue[i].stats;
+        TRACE_(d3d_perf)("Queue %u: %s packets, %s bytes, max occupancy %u bytes, "
+                "%u space waits, %u finish waits, %s ms waiting.\n", i,
+                wine_dbgstr_longlong(stats->packet_count), wine_dbgstr_longlong(stats->byte_count),
+                stats->max_occupancy, stats->space_wait_count, stats->finish_wait_count,
+                wine_dbgstr_longlong(stats->wait_time * 1000 / frequency.QuadPart));
+    }
+}
+
 void wined3d_cs_destroy(struct wined3d_cs *cs)
 {
     if (cs->thread)
@@ -3533,6 +3627,9 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
         CloseHandle(cs->thread);
         if (!CloseHandle(cs->event))
             ERR("Closing event failed.\n");
+        CloseHandle(cs->producer_event);
+        if (TRACE_ON(d3d_perf))
+            wined3d_cs_dump_queue_stats(cs);
     }
 
     wined3d_state_destroy(cs->c.state);
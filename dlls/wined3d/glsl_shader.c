@@ -38,6 +38,7 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
 WINE_DECLARE_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(winediag);
 
 #define WINED3D_GLSL_SAMPLE_PROJECTED   0x01
@@ -123,6 +124,30 @@ struct constant_heap
     unsigned int size;
 };
 
+enum glsl_program_cache_state
+{
+    GLSL_PROGRAM_CACHE_UNKNOWN,
+    GLSL_PROGRAM_CACHE_ENABLED,
+    GLSL_PROGRAM_CACHE_DISABLED,
+};
+
+#define GLSL_LINK_DUAL_SOURCE_BLEND         0x00000001u
+#define GLSL_LINK_NO_CACHE                  0x00000002u
+
+#define GLSL_PROGRAM_CACHE_MAGIC            0x4c534c47u /* "GLSL" */
+#define GLSL_PROGRAM_CACHE_VERSION          1
+/* Cached files are evicted least recently used first above this size. */
+#define GLSL_PROGRAM_CACHE_MAX_SIZE         (64u * 1024 * 1024)
+
+struct glsl_program_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    UINT64 key;
+    GLenum binary_format;
+    DWORD binary_size;
+};
+
 /* GLSL shader private data */
 struct shader_glsl_priv
 {
@@ -140,6 +165,13 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    enum glsl_program_cache_state program_cache_state;
+    char program_cache_dir[MAX_PATH];
+    UINT64 program_cache_driver_hash;
+    UINT64 program_cache_size;
+    unsigned int program_cache_hits;
+    unsigned int program_cache_misses;
 };
 
 struct glsl_vs_program
@@ -638,6 +670,321 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+static UINT64 glsl_program_cache_hash(UINT64 hash, const void *data, SIZE_T size)
+{
+    const unsigned char *ptr = data;
+    SIZE_T i;
+
+    /* 64-bit FNV-1a */
+    for (i = 0; i < size; ++i)
+        hash = (hash ^ ptr[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+struct glsl_program_cache_file
+{
+    FILETIME time;
+    UINT64 size;
+    char name[MAX_PATH];
+};
+
+static int __cdecl glsl_program_cache_file_compare(const void *a, const void *b)
+{
+    const struct glsl_program_cache_file *f1 = a, *f2 = b;
+
+    return CompareFileTime(&f1->time, &f2->time);
+}
+
+/* Deletes the least recently used files until the cache is at most max_size
+ * bytes large. Returns the resulting size. */
+static UINT64 shader_glsl_trim_program_cache(const struct shader_glsl_priv *priv, UINT64 max_size)
+{
+    struct glsl_program_cache_file *files = NULL, *new_files;
+    SIZE_T count = 0, capacity = 0, i;
+    char pattern[MAX_PATH], path[MAX_PATH];
+    WIN32_FIND_DATAA data;
+    UINT64 size = 0;
+    HANDLE find;
+
+    if (snprintf(pattern, ARRAY_SIZE(pattern), "%s\\*.bin", priv->program_cache_dir) >= ARRAY_SIZE(pattern))
+        return 0;
+    if ((find = FindFirstFileA(pattern, &data)) == INVALID_HANDLE_VALUE)
+        return 0;
+    do
+    {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            continue;
+        size += ((UINT64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        if (max_size == ~(UINT64)0)
+            continue;
+        if (count == capacity)
+        {
+            capacity = max(capacity * 2, 64);
+            if (!(new_files = heap_realloc(files, capacity * sizeof(*files))))
+                break;
+            files = new_files;
+        }
+        files[count].time = data.ftLastWriteTime;
+        files[count].size = ((UINT64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        strcpy(files[count].name, data.cFileName);
+        ++count;
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+
+    if (size > max_size && files)
+    {
+        qsort(files, count, sizeof(*files), glsl_program_cache_file_compare);
+        for (i = 0; i < count && size > max_size; ++i)
+        {
+            if (snprintf(path, ARRAY_SIZE(path), "%s\\%s", priv->program_cache_dir, files[i].name)
+                    >= ARRAY_SIZE(path))
+                continue;
+            TRACE("Evicting %s from the program cache.\n", debugstr_a(files[i].name));
+            if (DeleteFileA(path))
+                size -= files[i].size;
+        }
+    }
+    heap_free(files);
+    return size;
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_init_program_cache(const struct wined3d_gl_info *gl_info, struct shader_glsl_priv *priv)
+{
+    static const GLenum driver_strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    static const char *subdirs[] = {"\\wine", "\\wined3d", "\\glsl"};
+    /* Room for the subdirectories, a "\\<64-bit key>.bin" file name and the
+     * ".<pid>" suffix of temporary files. */
+    static const size_t reserve = sizeof("\\wine\\wined3d\\glsl") - 1
+            + sizeof("\\0123456789abcdef.bin") - 1 + sizeof(".01234567");
+    UINT64 hash = 0xcbf29ce484222325ull;
+    const char *str;
+    unsigned int i;
+    GLint count;
+    DWORD len;
+
+    if (priv->program_cache_state != GLSL_PROGRAM_CACHE_UNKNOWN)
+        return priv->program_cache_state == GLSL_PROGRAM_CACHE_ENABLED;
+    priv->program_cache_state = GLSL_PROGRAM_CACHE_DISABLED;
+
+    if (!wined3d_settings.shader_cache || !gl_info->supported[ARB_GET_PROGRAM_BINARY])
+        return FALSE;
+    gl_info->gl_ops.gl.p_glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+    if (!count)
+    {
+        TRACE("No program binary format available, not caching programs.\n");
+        return FALSE;
+    }
+
+    /* Program binaries are only valid for the driver that created them. */
+    for (i = 0; i < ARRAY_SIZE(driver_strings); ++i)
+    {
+        if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(driver_strings[i])))
+            hash = glsl_program_cache_hash(hash, str, strlen(str) + 1);
+    }
+    priv->program_cache_driver_hash = hash;
+
+    len = GetEnvironmentVariableA("LOCALAPPDATA", priv->program_cache_dir, ARRAY_SIZE(priv->program_cache_dir));
+    if (!len || len + reserve > ARRAY_SIZE(priv->program_cache_dir))
+    {
+        WARN("Failed to get the program cache directory.\n");
+        return FALSE;
+    }
+    for (i = 0; i < ARRAY_SIZE(subdirs); ++i)
+    {
+        strcat(priv->program_cache_dir, subdirs[i]);
+        if (!CreateDirectoryA(priv->program_cache_dir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+        {
+            WARN("Failed to create directory %s, error %u.\n",
+                    debugstr_a(priv->program_cache_dir), GetLastError());
+            return FALSE;
+        }
+    }
+
+    priv->program_cache_size = shader_glsl_trim_program_cache(priv, ~(UINT64)0);
+    TRACE("Caching GLSL programs in %s, %s bytes used.\n", debugstr_a(priv->program_cache_dir),
+            wine_dbgstr_longlong(priv->program_cache_size));
+    priv->program_cache_state = GLSL_PROGRAM_CACHE_ENABLED;
+    return TRUE;
+}
+
+/* The key is built from the source of all the shaders attached to the
+ * program, along with the state affecting the link. Context activation is
+ * done by the caller. */
+static BOOL shader_glsl_get_program_cache_key(const struct wined3d_gl_info *gl_info,
+        const struct shader_glsl_priv *priv, GLuint program, DWORD flags, UINT64 *key)
+{
+    GLint i, shader_count, source_size = 0, length, type;
+    char *source = NULL;
+    GLuint *shaders;
+    UINT64 hash;
+
+    GL_EXTCALL(glGetProgramiv(program, GL_ATTACHED_SHADERS, &shader_count));
+    if (!(shaders = heap_calloc(shader_count, sizeof(*shaders))))
+        return FALSE;
+    GL_EXTCALL(glGetAttachedShaders(program, shader_count, NULL, shaders));
+
+    hash = glsl_program_cache_hash(priv->program_cache_driver_hash, &flags, sizeof(flags));
+    *key = hash;
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        if (source_size < length)
+        {
+            heap_free(source);
+            if (!(source = heap_alloc(length)))
+            {
+                heap_free(shaders);
+                return FALSE;
+            }
+            source_size = length;
+        }
+        GL_EXTCALL(glGetShaderSource(shaders[i], source_size, &length, source));
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type));
+
+        /* The order in which shaders are returned isn't defined. */
+        hash = glsl_program_cache_hash(0xcbf29ce484222325ull, &type, sizeof(type));
+        *key += glsl_program_cache_hash(hash, source, length);
+    }
+    checkGLcall("get program cache key");
+
+    heap_free(source);
+    heap_free(shaders);
+    return TRUE;
+}
+
+static BOOL shader_glsl_get_program_cache_path(const struct shader_glsl_priv *priv, UINT64 key, char *path)
+{
+    return snprintf(path, MAX_PATH, "%s\\%08x%08x.bin", priv->program_cache_dir,
+            (unsigned int)(key >> 32), (unsigned int)key) < MAX_PATH;
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_load_cached_program(const struct wined3d_gl_info *gl_info,
+        const struct shader_glsl_priv *priv, GLuint program, UINT64 key)
+{
+    struct glsl_program_cache_header header;
+    char path[MAX_PATH];
+    void *binary = NULL;
+    GLint status = 0;
+    HANDLE file;
+    DWORD size;
+
+    if (!shader_glsl_get_program_cache_path(priv, key, path))
+        return FALSE;
+    file = CreateFileA(path, GENERIC_READ | FILE_WRITE_ATTRIBUTES,
+            FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    if (ReadFile(file, &header, sizeof(header), &size, NULL) && size == sizeof(header)
+            && header.magic == GLSL_PROGRAM_CACHE_MAGIC && header.version == GLSL_PROGRAM_CACHE_VERSION
+            && header.key == key && (binary = heap_alloc(header.binary_size))
+            && ReadFile(file, binary, header.binary_size, &size, NULL) && size == header.binary_size)
+    {
+        GL_EXTCALL(glProgramBinary(program, header.binary_format, binary, header.binary_size));
+        checkGLcall("glProgramBinary");
+        GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+        if (!status)
+            WARN("Failed to load cached binary for program %u.\n", program);
+    }
+    if (status)
+    {
+        FILETIME now;
+
+        /* Eviction goes by the last write time, mark the file as recently used. */
+        GetSystemTimeAsFileTime(&now);
+        SetFileTime(file, NULL, NULL, &now);
+    }
+    heap_free(binary);
+    CloseHandle(file);
+
+    return !!status;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_store_cached_program(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program, UINT64 key)
+{
+    struct glsl_program_cache_header *header;
+    char path[MAX_PATH], tmp_path[MAX_PATH];
+    GLint status, length;
+    BOOL ret = FALSE;
+    HANDLE file;
+    DWORD size;
+
+    GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+    if (!status)
+        return;
+    GL_EXTCALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (!length || !(header = heap_alloc(sizeof(*header) + length)))
+        return;
+
+    GL_EXTCALL(glGetProgramBinary(program, length, &length, &header->binary_format, header + 1));
+    checkGLcall("glGetProgramBinary");
+    header->magic = GLSL_PROGRAM_CACHE_MAGIC;
+    header->version = GLSL_PROGRAM_CACHE_VERSION;
+    header->key = key;
+    header->binary_size = length;
+
+    /* Write to a temporary file first, so that other processes never see a
+     * partially written file. */
+    if (!shader_glsl_get_program_cache_path(priv, key, path)
+            || snprintf(tmp_path, ARRAY_SIZE(tmp_path), "%s.%x", path, GetCurrentProcessId()) >= ARRAY_SIZE(tmp_path))
+    {
+        heap_free(header);
+        return;
+    }
+    file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        ret = WriteFile(file, header, sizeof(*header) + length, &size, NULL) && size == sizeof(*header) + length;
+        CloseHandle(file);
+        if (!ret || !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+        {
+            WARN("Failed to store binary for program %u.\n", program);
+            DeleteFileA(tmp_path);
+            ret = FALSE;
+        }
+    }
+    heap_free(header);
+
+    /* Other processes may use the same cache, so the size is only an
+     * estimate; trim below the limit to avoid scanning on every store. */
+    if (ret && (priv->program_cache_size += sizeof(*header) + length) > GLSL_PROGRAM_CACHE_MAX_SIZE)
+        priv->program_cache_size = shader_glsl_trim_program_cache(priv, GLSL_PROGRAM_CACHE_MAX_SIZE / 4 * 3);
+}
+
+/* Links a program, loading it from the program cache when possible.
+ * Context activation is done by the caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program, DWORD flags)
+{
+    BOOL cache = FALSE;
+    UINT64 key;
+
+    if (!(flags & GLSL_LINK_NO_CACHE) && shader_glsl_init_program_cache(gl_info, priv)
+            && shader_glsl_get_program_cache_key(gl_info, priv, program, flags, &key))
+    {
+        if (shader_glsl_load_cached_program(gl_info, priv, program, key))
+        {
+            TRACE("Loaded GLSL shader program %u from the cache.\n", program);
+            ++priv->program_cache_hits;
+            return;
+        }
+        ++priv->program_cache_misses;
+        GL_EXTCALL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        cache = TRUE;
+    }
+
+    TRACE("Linking GLSL shader program %u.\n", program);
+    GL_EXTCALL(glLinkProgram(program));
+    shader_glsl_validate_link(gl_info, program);
+
+    if (cache)
+        shader_glsl_store_cached_program(gl_info, priv, program, key);
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -10156,9 +10503,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, priv, program_id, 0);
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10240,6 +10585,7 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
     GLuint ps_id = 0;
     struct list *ps_list, *vs_list;
     WORD attribs_map;
+    DWORD link_flags;
     struct wined3d_string_buffer *tmp_name;
 
     if (!(context_gl->c.shader_update_mask & (1u << WINED3D_SHADER_TYPE_VERTEX)) && ctx_data->glsl_program)
@@ -10489,9 +10835,13 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
     }
 
     /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    link_flags = 0;
+    if (state->blend_state && state->blend_state->dual_source)
+        link_flags |= GLSL_LINK_DUAL_SOURCE_BLEND;
+    /* FIXME: The stream output declaration isn't part of the key. */
+    if (gshader && gshader->u.gs.so_desc)
+        link_flags |= GLSL_LINK_NO_CACHE;
+    shader_glsl_link_program(gl_info, priv, program_id, link_flags);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -11111,6 +11461,10 @@ static void shader_glsl_free(struct wined3d_device *device, struct wined3d_conte
 {
     struct shader_glsl_priv *priv = device->shader_priv;
 
+    if (priv->program_cache_state == GLSL_PROGRAM_CACHE_ENABLED)
+        TRACE_(d3d_perf)("GLSL program cache: %u hits, %u misses.\n",
+                priv->program_cache_hits, priv->program_cache_misses);
+
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
@@ -124,6 +124,8 @@ struct wined3d_settings wined3d_settings =
     .max_sm_cs = UINT_MAX,
     .renderer = WINED3D_RENDERER_AUTO,
     .shader_backend = WINED3D_SHADER_BACKEND_AUTO,
+    .shader_cache = TRUE,
+    .cs_spin_count = WINED3D_CS_SPIN_COUNT,
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -265,6 +267,8 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
     {
         if (!get_config_key_dword(hkey, appkey, "csmt", &wined3d_settings.cs_multithreaded))
             ERR_(winediag)("Setting multithreaded command stream to %#x.\n", wined3d_settings.cs_multithreaded);
+        if (!get_config_key_dword(hkey, appkey, "csmt_spin_count", &wined3d_settings.cs_spin_count))
+            ERR_(winediag)("Setting command stream spin count to %u.\n", wined3d_settings.cs_spin_count);
         if (!get_config_key_dword(hkey, appkey, "MaxVersionGL", &tmpvalue))
         {
             ERR_(winediag)("Setting maximum allowed wined3d GL version to %u.%u.\n",
@@ -398,6 +402,11 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Forcing all constant buffers to be write-mappable.\n");
             wined3d_settings.cb_access_map_w = TRUE;
         }
+        if (!get_config_key_dword(hkey, appkey, "shader_cache", &tmpvalue) && !tmpvalue)
+        {
+            TRACE("Disabling the shader cache.\n");
+            wined3d_settings.shader_cache = FALSE;
+        }
     }
 
     if (appkey) RegCloseKey( appkey );
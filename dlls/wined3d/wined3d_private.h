@@ -497,6 +497,8 @@ struct wined3d_settings
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
     BOOL cb_access_map_w;
+    BOOL shader_cache;
+    unsigned int cs_spin_count;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -4846,10 +4848,24 @@ enum wined3d_push_constants
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
 #define WINED3D_CS_QUEUE_SIZE           0x100000u
 #define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_PRODUCER_SPIN_COUNT  4000u
+#define WINED3D_CS_WAIT_TIMEOUT         1u
+
+struct wined3d_cs_queue_stats
+{
+    ULONG64 packet_count;
+    ULONG64 byte_count;
+    unsigned int max_occupancy;
+    /* Producer waits, for free space and for the queue to drain. */
+    unsigned int space_wait_count;
+    unsigned int finish_wait_count;
+    ULONG64 wait_time;
+};
 
 struct wined3d_cs_queue
 {
     LONG head, tail;
+    struct wined3d_cs_queue_stats stats;
     BYTE data[WINED3D_CS_QUEUE_SIZE];
 };
 
@@ -4902,6 +4918,9 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+
+    HANDLE producer_event;
+    LONG producer_waiting;
 };
 
 static inline void wined3d_device_context_lock(struct wined3d_device_context *context)
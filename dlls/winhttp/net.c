@@ -255,6 +255,7 @@ void netconn_close( struct netconn *conn )
         DeleteSecurityContext(&conn->ssl_ctx);
     }
     closesocket( conn->socket );
+    if (conn->active) release_host_slot( conn->host );
     release_host( conn->host );
     free(conn);
 }
@@ -1335,21 +1335,62 @@ void release_host( struct hostdata *host )
     if (ref) return;
 
     assert( list_empty( &host->connections ) );
+    host->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection( &host->cs );
     free( host->hostname );
     free( host );
 }
 
+/* wait until fewer than max connections to the host are in use, and take one of the slots */
+static DWORD acquire_host_slot( struct hostdata *host, DWORD max, DWORD timeout )
+{
+    ULONGLONG end = GetTickCount64() + timeout;
+    DWORD ret = ERROR_SUCCESS;
+
+    EnterCriticalSection( &host->cs );
+    while (max && host->active >= max)
+    {
+        DWORD wait = timeout;
+
+        if (timeout != INFINITE)
+        {
+            ULONGLONG now = GetTickCount64();
+            if (now >= end)
+            {
+                ret = ERROR_WINHTTP_TIMEOUT;
+                break;
+            }
+            wait = end - now;
+        }
+        TRACE( "waiting for one of the %u connections to %s\n", host->active, debugstr_w(host->hostname) );
+        SleepConditionVariableCS( &host->slot_freed, &host->cs, wait );
+    }
+    if (!ret) host->active++;
+    LeaveCriticalSection( &host->cs );
+    return ret;
+}
+
+void release_host_slot( struct hostdata *host )
+{
+    EnterCriticalSection( &host->cs );
+    host->active--;
+    LeaveCriticalSection( &host->cs );
+    WakeConditionVariable( &host->slot_freed );
+}
+
 static BOOL connection_collector_running;
 
 static void CALLBACK connection_collector( TP_CALLBACK_INSTANCE *instance, void *ctx )
 {
     unsigned int remaining_connections;
     struct netconn *netconn, *next_netconn;
-    struct hostdata *host, *next_host;
+    struct hostdata *host;
     ULONGLONG now;
 
     do
     {
+        struct list expired = LIST_INIT(expired);
+
         /* FIXME: Use more sophisticated method */
         Sleep(5000);
         remaining_connections = 0;
@@ -1357,23 +1398,32 @@ static void CALLBACK connection_collector( TP_CALLBACK_INSTANCE *instance, void
 
         EnterCriticalSection(&connection_pool_cs);
 
-        LIST_FOR_EACH_ENTRY_SAFE(host, next_host, &connection_pool, struct hostdata, entry)
+        LIST_FOR_EACH_ENTRY(host, &connection_pool, struct hostdata, entry)
         {
+            EnterCriticalSection(&host->cs);
             LIST_FOR_EACH_ENTRY_SAFE(netconn, next_netconn, &host->connections, struct netconn, entry)
             {
                 if (netconn->keep_until < now)
                 {
-                    TRACE("freeing %p\n", netconn);
                     list_remove(&netconn->entry);
-                    netconn_close(netconn);
+                    list_add_tail(&expired, &netconn->entry);
                 }
                 else remaining_connections++;
             }
+            LeaveCriticalSection(&host->cs);
         }
 
         if (!remaining_connections) connection_collector_running = FALSE;
 
         LeaveCriticalSection(&connection_pool_cs);
+
+        /* the expired connections hold references to their hosts, so close them only now */
+        LIST_FOR_EACH_ENTRY_SAFE(netconn, next_netconn, &expired, struct netconn, entry)
+        {
+            TRACE("freeing %p\n", netconn);
+            list_remove(&netconn->entry);
+            netconn_close(netconn);
+        }
     } while(remaining_connections);
 
     FreeLibraryWhenCallbackReturns( instance, winhttp_instance );
@@ -1381,12 +1431,22 @@ static void CALLBACK connection_collector( TP_CALLBACK_INSTANCE *instance, void
 
 static void cache_connection( struct netconn *netconn )
 {
-    TRACE( "caching connection %p\n", netconn );
+    struct hostdata *host = netconn->host;
 
-    EnterCriticalSection( &connection_pool_cs );
+    TRACE( "caching connection %p\n", netconn );
 
+    EnterCriticalSection( &host->cs );
     netconn->keep_until = GetTickCount64() + DEFAULT_KEEP_ALIVE_TIMEOUT;
-    list_add_head( &netconn->host->connections, &netconn->entry );
+    list_add_head( &host->connections, &netconn->entry );
+    if (netconn->active)
+    {
+        netconn->active = FALSE;
+        host->active--;
+        WakeConditionVariable( &host->slot_freed );
+    }
+    LeaveCriticalSection( &host->cs );
+
+    EnterCriticalSection( &connection_pool_cs );
 
     if (!connection_collector_running)
     {
@@ -1450,6 +1510,7 @@ static DWORD open_connection( struct request *request )
     struct netconn *netconn = NULL;
     struct connect *connect;
     WCHAR *addressW = NULL;
+    DWORD timeout = INFINITE;
     INTERNET_PORT port;
     DWORD ret, len;
 
@@ -1478,8 +1539,12 @@ static DWORD open_connection( struct request *request )
             host->secure = is_secure;
             host->port = port;
             list_init( &host->connections );
+            host->active = 0;
+            InitializeConditionVariable( &host->slot_freed );
             if ((host->hostname = strdupW( connect->servername )))
             {
+                InitializeCriticalSection( &host->cs );
+                host->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": hostdata.cs");
                 list_add_head( &connection_pool, &host->entry );
             }
             else
@@ -1494,18 +1559,31 @@ static DWORD open_connection( struct request *request )
 
     if (!host) return ERROR_OUTOFMEMORY;
 
+    /* the wait for a free connection counts against the time allowed to resolve and connect */
+    if (request->connect_timeout > 0)
+        timeout = request->connect_timeout + max( request->resolve_timeout, 0 );
+    if ((ret = acquire_host_slot( host, connect->session->max_conns, timeout )))
+    {
+        release_host( host );
+        return ret;
+    }
+
     for (;;)
     {
-        EnterCriticalSection( &connection_pool_cs );
+        EnterCriticalSection( &host->cs );
         if (!list_empty( &host->connections ))
         {
             netconn = LIST_ENTRY( list_head( &host->connections ), struct netconn, entry );
             list_remove( &netconn->entry );
         }
-        LeaveCriticalSection( &connection_pool_cs );
+        LeaveCriticalSection( &host->cs );
         if (!netconn) break;
 
-        if (netconn_is_alive( netconn )) break;
+        if (netconn_is_alive( netconn ))
+        {
+            netconn->active = TRUE;
+            break;
+        }
         TRACE("connection %p no longer alive, closing\n", netconn);
         netconn_close( netconn );
         netconn = NULL;
@@ -1524,6 +1602,7 @@ static DWORD open_connection( struct request *request )
 
         if ((ret = netconn_resolve( host->hostname, port, &connect->sockaddr, request->resolve_timeout )))
         {
+            release_host_slot( host );
             release_host( host );
             return ret;
         }
@@ -1531,6 +1610,7 @@ static DWORD open_connection( struct request *request )
 
         if (!(addressW = addr_to_str( &connect->sockaddr )))
         {
+            release_host_slot( host );
             release_host( host );
             return ERROR_OUTOFMEMORY;
         }
@@ -1542,6 +1622,7 @@ static DWORD open_connection( struct request *request )
     {
         if (!addressW && !(addressW = addr_to_str( &connect->sockaddr )))
         {
+            release_host_slot( host );
             release_host( host );
             return ERROR_OUTOFMEMORY;
         }
@@ -1554,9 +1635,11 @@ static DWORD open_connection( struct request *request )
         if ((ret = netconn_create( host, &connect->sockaddr, request->connect_timeout, &netconn )))
         {
             free( addressW );
+            release_host_slot( host );
             release_host( host );
             return ret;
         }
+        netconn->active = TRUE;
         netconn_set_timeout( netconn, TRUE, request->send_timeout );
         netconn_set_timeout( netconn, FALSE, request->receive_response_timeout );
 
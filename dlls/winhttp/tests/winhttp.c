@@ -3626,6 +3626,78 @@ static void test_multiple_reads(int port)
     WinHttpCloseHandle(ses);
 }
 
+static void test_max_conns_per_server( int port )
+{
+    HINTERNET ses, con, req, req2;
+    DWORD value, size, err;
+    BOOL ret;
+
+    ses = WinHttpOpen( L"winetest", WINHTTP_ACCESS_TYPE_NO_PROXY, NULL, NULL, 0 );
+    ok( ses != NULL, "failed to open session %u\n", GetLastError() );
+
+    value = 2;
+    ret = WinHttpSetOption( ses, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &value, sizeof(value) );
+    ok( ret, "failed to set option %u\n", GetLastError() );
+
+    value = 0xdeadbeef;
+    size = sizeof(value);
+    ret = WinHttpQueryOption( ses, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &value, &size );
+    ok( ret, "failed to query option %u\n", GetLastError() );
+    ok( value == 2, "got %u\n", value );
+    ok( size == sizeof(value), "got %u\n", size );
+
+    SetLastError( 0xdeadbeef );
+    ret = WinHttpSetOption( ses, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &value, sizeof(value) - 1 );
+    err = GetLastError();
+    ok( !ret, "succeeded\n" );
+    ok( err == ERROR_INVALID_PARAMETER, "got %u\n", err );
+
+    /* zero removes the limit */
+    value = 0;
+    ret = WinHttpSetOption( ses, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &value, sizeof(value) );
+    ok( ret, "failed to set option %u\n", GetLastError() );
+
+    value = 0xdeadbeef;
+    size = sizeof(value);
+    ret = WinHttpQueryOption( ses, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &value, &size );
+    ok( ret, "failed to query option %u\n", GetLastError() );
+    ok( !value, "got %u\n", value );
+
+    value = 1;
+    ret = WinHttpSetOption( ses, WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &value, sizeof(value) );
+    ok( ret, "failed to set option %u\n", GetLastError() );
+
+    ret = WinHttpSetTimeouts( ses, 0, 500, 5000, 5000 );
+    ok( ret, "failed to set timeouts %u\n", GetLastError() );
+
+    con = WinHttpConnect( ses, L"localhost", port, 0 );
+    ok( con != NULL, "failed to open a connection %u\n", GetLastError() );
+
+    req = WinHttpOpenRequest( con, NULL, L"/basic", NULL, NULL, NULL, 0 );
+    ok( req != NULL, "failed to open a request %u\n", GetLastError() );
+
+    ret = WinHttpSendRequest( req, NULL, 0, NULL, 0, 0, 0 );
+    ok( ret, "failed to send request %u\n", GetLastError() );
+
+    ret = WinHttpReceiveResponse( req, NULL );
+    ok( ret, "failed to receive response %u\n", GetLastError() );
+
+    /* the first request still owns the only connection allowed to the server */
+    req2 = WinHttpOpenRequest( con, NULL, L"/basic", NULL, NULL, NULL, 0 );
+    ok( req2 != NULL, "failed to open a request %u\n", GetLastError() );
+
+    SetLastError( 0xdeadbeef );
+    ret = WinHttpSendRequest( req2, NULL, 0, NULL, 0, 0, 0 );
+    err = GetLastError();
+    ok( !ret, "request succeeded\n" );
+    ok( err == ERROR_WINHTTP_TIMEOUT, "got %u\n", err );
+
+    WinHttpCloseHandle( req2 );
+    WinHttpCloseHandle( req );
+    WinHttpCloseHandle( con );
+    WinHttpCloseHandle( ses );
+}
+
 static void test_cookies( int port )
 {
     HINTERNET ses, con, req;
@@ -5580,6 +5652,7 @@ START_TEST (winhttp)
     test_large_data_authentication(si.port);
     test_bad_header(si.port);
     test_multiple_reads(si.port);
+    test_max_conns_per_server(si.port);
     test_cookies(si.port);
     test_request_path_escapes(si.port);
     test_passport_auth(si.port);
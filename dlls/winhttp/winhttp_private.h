@@ -60,7 +60,10 @@ struct hostdata
     WCHAR *hostname;
     INTERNET_PORT port;
     BOOL secure;
-    struct list connections;
+    CRITICAL_SECTION cs;            /* protects the fields below */
+    struct list connections;        /* idle connections */
+    unsigned int active;            /* connections in use by requests */
+    CONDITION_VARIABLE slot_freed;
 };
 
 struct session
@@ -82,6 +85,7 @@ struct session
     HANDLE unload_event;
     DWORD secure_protocols;
     DWORD passport_flags;
+    DWORD max_conns;
 };
 
 struct connect
@@ -105,6 +109,7 @@ struct netconn
     struct sockaddr_storage sockaddr;
     BOOL secure; /* SSL active on connection? */
     struct hostdata *host;
+    BOOL active; /* holds one of the host's active connection slots? */
     ULONGLONG keep_until;
     CtxtHandle ssl_ctx;
     SecPkgContext_StreamSizes ssl_sizes;
@@ -342,6 +347,7 @@ BOOL set_server_for_hostname( struct connect *, const WCHAR *, INTERNET_PORT ) D
 void destroy_authinfo( struct authinfo * ) DECLSPEC_HIDDEN;
 
 void release_host( struct hostdata * ) DECLSPEC_HIDDEN;
+void release_host_slot( struct hostdata * ) DECLSPEC_HIDDEN;
 DWORD process_header( struct request *, const WCHAR *, const WCHAR *, DWORD, BOOL ) DECLSPEC_HIDDEN;
 
 extern HRESULT WinHttpRequest_create( void ** ) DECLSPEC_HIDDEN;
@@ -185,6 +185,7 @@ typedef struct
     char *cache_prefix; /* string that has to be prefixed for this container to be used */
     LPWSTR path; /* path to url container directory */
     HANDLE mapping; /* handle of file mapping */
+    urlcache_header *header; /* view of the mapping, kept between index locks */
     DWORD file_size; /* size of file when mapping was opened */
     HANDLE mutex; /* handle of mutex */
     DWORD default_entry_type;
@@ -285,6 +286,13 @@ static DWORD urlcache_entry_alloc(urlcache_header *header, DWORD blocks_needed,
 
     for(block=0; block<header->capacity_in_blocks; block+=block_size+1)
     {
+        /* skip fully allocated parts of the table a byte at a time */
+        if(!(block%CHAR_BIT) && header->allocation_table[block/CHAR_BIT] == 0xff)
+        {
+            block_size = CHAR_BIT-1;
+            continue;
+        }
+
         block_size = 0;
         while(block_size<blocks_needed && block_size+block<header->capacity_in_blocks
                 && urlcache_block_is_free(header->allocation_table, block+block_size))
@@ -673,6 +681,11 @@ static DWORD cache_container_open_index(cache_container *container, DWORD blocks
  */
 static void cache_container_close_index(cache_container *pContainer)
 {
+    if (pContainer->header)
+    {
+        UnmapViewOfFile(pContainer->header);
+        pContainer->header = NULL;
+    }
     CloseHandle(pContainer->mapping);
     pContainer->mapping = NULL;
 }
@@ -689,6 +702,7 @@ static BOOL cache_containers_add(const char *cache_prefix, LPCWSTR path,
     }
 
     pContainer->mapping = NULL;
+    pContainer->header = NULL;
     pContainer->file_size = 0;
     pContainer->default_entry_type = default_entry_type;
 
@@ -875,7 +889,9 @@ static BOOL cache_containers_enum(char *search_pattern, DWORD index, cache_conta
 /***********************************************************************
  *           cache_container_lock_index (Internal)
  *
- * Locks the index for system-wide exclusive access.
+ * Locks the index for system-wide exclusive access. The view of the
+ * index stays mapped between locks, it's only remapped when another
+ * process has grown the file.
  *
  * RETURNS
  *  Cache file header if successful
@@ -884,29 +900,29 @@ static BOOL cache_containers_enum(char *search_pattern, DWORD index, cache_conta
 static urlcache_header* cache_container_lock_index(cache_container *pContainer)
 {
     BYTE index;
-    LPVOID pIndexData;
     urlcache_header* pHeader;
     DWORD error;
 
     /* acquire mutex */
     WaitForSingleObject(pContainer->mutex, INFINITE);
 
-    pIndexData = MapViewOfFile(pContainer->mapping, FILE_MAP_WRITE, 0, 0, 0);
-
-    if (!pIndexData)
+    if (!pContainer->header)
     {
-        ReleaseMutex(pContainer->mutex);
-        ERR("Couldn't MapViewOfFile. Error: %d\n", GetLastError());
-        return NULL;
+        pContainer->header = MapViewOfFile(pContainer->mapping, FILE_MAP_WRITE, 0, 0, 0);
+        if (!pContainer->header)
+        {
+            ReleaseMutex(pContainer->mutex);
+            ERR("Couldn't MapViewOfFile. Error: %d\n", GetLastError());
+            return NULL;
+        }
     }
-    pHeader = (urlcache_header*)pIndexData;
+    pHeader = pContainer->header;
 
     /* file has grown - we need to remap to prevent us getting
      * access violations when we try and access beyond the end
      * of the memory mapped file */
     if (pHeader->size != pContainer->file_size)
     {
-        UnmapViewOfFile( pHeader );
         cache_container_close_index(pContainer);
         error = cache_container_open_index(pContainer, MIN_BLOCK_NO);
         if (error != ERROR_SUCCESS)
@@ -915,15 +931,15 @@ static urlcache_header* cache_container_lock_index(cache_container *pContainer)
             SetLastError(error);
             return NULL;
         }
-        pIndexData = MapViewOfFile(pContainer->mapping, FILE_MAP_WRITE, 0, 0, 0);
+        pContainer->header = MapViewOfFile(pContainer->mapping, FILE_MAP_WRITE, 0, 0, 0);
 
-        if (!pIndexData)
+        if (!pContainer->header)
         {
             ReleaseMutex(pContainer->mutex);
             ERR("Couldn't MapViewOfFile. Error: %d\n", GetLastError());
             return NULL;
         }
-        pHeader = (urlcache_header*)pIndexData;
+        pHeader = pContainer->header;
     }
 
     TRACE("Signature: %s, file size: %d bytes\n", pHeader->signature, pHeader->size);
@@ -942,9 +958,15 @@ static urlcache_header* cache_container_lock_index(cache_container *pContainer)
  */
 static BOOL cache_container_unlock_index(cache_container *pContainer, urlcache_header *pHeader)
 {
+    BOOL ret = TRUE;
+
+    /* a view replaced while the index was locked is released here */
+    if (pHeader != pContainer->header)
+        ret = UnmapViewOfFile(pHeader);
+
     /* release mutex */
     ReleaseMutex(pContainer->mutex);
-    return UnmapViewOfFile(pHeader);
+    return ret;
 }
 
 /***********************************************************************
@@ -1173,6 +1195,8 @@ static DWORD cache_container_clean_index(cache_container *container, urlcache_he
         return ERROR_NOT_ENOUGH_MEMORY;
     }
 
+    /* the caller's view is still used if growing the index fails */
+    container->header = NULL;
     cache_container_close_index(container);
     ret = cache_container_open_index(container, header->capacity_in_blocks*2);
     if(ret != ERROR_SUCCESS)
@@ -1182,7 +1206,7 @@ static DWORD cache_container_clean_index(cache_container *container, urlcache_he
         return GetLastError();
 
     UnmapViewOfFile(*file_view);
-    *file_view = header;
+    *file_view = container->header = header;
     return ERROR_SUCCESS;
 }
 
@@ -3812,7 +3836,9 @@ BOOL WINAPI GetUrlCacheConfigInfoW(LPINTERNET_CACHE_CONFIG_INFOW info, LPDWORD s
     info->dwCacheSize = container->file_size / 1024;
     lstrcpynW(info->CachePath, container->path, MAX_PATH);
 
+    WaitForSingleObject(container->mutex, INFINITE);
     cache_container_close_index(container);
+    ReleaseMutex(container->mutex);
 
     TRACE("CachePath %s\n", debugstr_w(info->CachePath));
 
@@ -69,6 +69,316 @@ static int do_getaddrinfo( const char *node, const char *service,
     }
 }
 
+/* The host resolver doesn't report record TTLs, so getaddrinfo() results are
+ * kept for a fixed time, configurable like the native DNS client cache. */
+#define ADDRINFO_CACHE_SIZE 128
+
+struct addrinfo_cache_entry
+{
+    struct list entry;
+    char *node;
+    char *service;
+    int has_hints;
+    int flags;
+    int family;
+    int socktype;
+    int protocol;
+    int error;
+    struct addrinfo *info;
+    unsigned int size;
+    ULONGLONG expire;           /* tick count when the entry becomes stale */
+    ULONGLONG refresh;          /* tick count after which a hit refreshes the entry */
+    BOOL refreshing;
+};
+
+struct addrinfo_refresh_args
+{
+    char *node;
+    char *service;
+    struct addrinfo *hints;
+    unsigned int serial;
+    HMODULE module;             /* keeps ws2_32 loaded until the callback returns */
+};
+
+static struct list addrinfo_cache = LIST_INIT( addrinfo_cache );
+static unsigned int addrinfo_cache_count;
+static unsigned int addrinfo_cache_serial;
+static DWORD addrinfo_cache_ttl = 60;
+static DWORD addrinfo_negative_cache_ttl = 5;
+static INIT_ONCE addrinfo_cache_init_once = INIT_ONCE_STATIC_INIT;
+
+DECLARE_CRITICAL_SECTION(cs_addrinfo_cache);
+
+static BOOL WINAPI addrinfo_cache_init( INIT_ONCE *once, void *param, void **context )
+{
+    DWORD value, size = sizeof(value);
+    HKEY key;
+
+    if (RegOpenKeyExW( HKEY_LOCAL_MACHINE, L"System\\CurrentControlSet\\Services\\Dnscache\\Parameters",
+                       0, KEY_READ, &key ))
+        return TRUE;
+    if (!RegQueryValueExW( key, L"MaxCacheTtl", NULL, NULL, (BYTE *)&value, &size ) && size == sizeof(value))
+        addrinfo_cache_ttl = value;
+    size = sizeof(value);
+    if (!RegQueryValueExW( key, L"MaxNegativeCacheTtl", NULL, NULL, (BYTE *)&value, &size ) && size == sizeof(value))
+        addrinfo_negative_cache_ttl = value;
+    RegCloseKey( key );
+    TRACE( "ttl %u, negative ttl %u\n", addrinfo_cache_ttl, addrinfo_negative_cache_ttl );
+    return TRUE;
+}
+
+/* do_getaddrinfo() returns the whole list in a single block */
+static unsigned int get_addrinfo_block_size( const struct addrinfo *info )
+{
+    const char *end = (const char *)info;
+    const struct addrinfo *ai;
+
+    for (ai = info; ai; ai = ai->ai_next)
+    {
+        if ((const char *)(ai + 1) > end) end = (const char *)(ai + 1);
+        if (ai->ai_canonname && ai->ai_canonname + strlen( ai->ai_canonname ) + 1 > end)
+            end = ai->ai_canonname + strlen( ai->ai_canonname ) + 1;
+        if (ai->ai_addr && (const char *)ai->ai_addr + ai->ai_addrlen > end)
+            end = (const char *)ai->ai_addr + ai->ai_addrlen;
+    }
+    return end - (const char *)info;
+}
+
+static struct addrinfo *copy_addrinfo_block( const struct addrinfo *src, unsigned int size )
+{
+    struct addrinfo *dst, *ai;
+
+    if (!(dst = malloc( size ))) return NULL;
+    memcpy( dst, src, size );
+
+#define RELOCATE(ptr) (ptr) = (void *)((char *)dst + ((char *)(ptr) - (char *)src))
+    for (ai = dst; ai; ai = ai->ai_next)
+    {
+        if (ai->ai_canonname) RELOCATE( ai->ai_canonname );
+        if (ai->ai_addr) RELOCATE( ai->ai_addr );
+        if (ai->ai_next) RELOCATE( ai->ai_next );
+    }
+#undef RELOCATE
+    return dst;
+}
+
+static BOOL addrinfo_cache_match( const struct addrinfo_cache_entry *cache, const char *node,
+                                  const char *service, const struct addrinfo *hints )
+{
+    if (strcasecmp( cache->node, node )) return FALSE;
+    if (!cache->service != !service) return FALSE;
+    if (service && strcmp( cache->service, service )) return FALSE;
+    if (cache->has_hints != !!hints) return FALSE;
+    if (!hints) return TRUE;
+    return cache->flags == hints->ai_flags && cache->family == hints->ai_family &&
+           cache->socktype == hints->ai_socktype && cache->protocol == hints->ai_protocol;
+}
+
+/* cs_addrinfo_cache must be held */
+static struct addrinfo_cache_entry *find_addrinfo_cache( const char *node, const char *service,
+                                                         const struct addrinfo *hints )
+{
+    struct addrinfo_cache_entry *cache;
+
+    LIST_FOR_EACH_ENTRY( cache, &addrinfo_cache, struct addrinfo_cache_entry, entry )
+        if (addrinfo_cache_match( cache, node, service, hints )) return cache;
+    return NULL;
+}
+
+static void free_addrinfo_cache( struct addrinfo_cache_entry *cache )
+{
+    list_remove( &cache->entry );
+    addrinfo_cache_count--;
+    free( cache->node );
+    free( cache->service );
+    free( cache->info );
+    free( cache );
+}
+
+static BOOL is_addrinfo_cacheable( int error )
+{
+    return !error || error == WSAHOST_NOT_FOUND || error == WSANO_DATA;
+}
+
+static void store_addrinfo_cache( const char *node, const char *service, const struct addrinfo *hints,
+                                  int error, const struct addrinfo *info, unsigned int serial )
+{
+    struct addrinfo_cache_entry *cache;
+    DWORD ttl = error ? addrinfo_negative_cache_ttl : addrinfo_cache_ttl;
+    ULONGLONG now = GetTickCount64();
+
+    if (!ttl || !is_addrinfo_cacheable( error )) return;
+
+    if (!(cache = calloc( 1, sizeof(*cache) ))) return;
+    if (!(cache->node = strdup( node )) || (service && !(cache->service = strdup( service ))))
+        goto failed;
+    if (!error)
+    {
+        cache->size = get_addrinfo_block_size( info );
+        if (!(cache->info = copy_addrinfo_block( info, cache->size ))) goto failed;
+    }
+    if ((cache->has_hints = !!hints))
+    {
+        cache->flags    = hints->ai_flags;
+        cache->family   = hints->ai_family;
+        cache->socktype = hints->ai_socktype;
+        cache->protocol = hints->ai_protocol;
+    }
+    cache->error   = error;
+    cache->expire  = now + ttl * 1000;
+    cache->refresh = now + ttl * 750;
+
+    EnterCriticalSection( &cs_addrinfo_cache );
+    if (serial == addrinfo_cache_serial)
+    {
+        struct addrinfo_cache_entry *old;
+
+        if ((old = find_addrinfo_cache( node, service, hints ))) free_addrinfo_cache( old );
+        else if (addrinfo_cache_count == ADDRINFO_CACHE_SIZE)
+            free_addrinfo_cache( LIST_ENTRY( list_tail( &addrinfo_cache ), struct addrinfo_cache_entry, entry ) );
+        list_add_head( &addrinfo_cache, &cache->entry );
+        addrinfo_cache_count++;
+        cache = NULL;
+    }
+    LeaveCriticalSection( &cs_addrinfo_cache );
+    if (!cache) return;
+
+failed:
+    free( cache->node );
+    free( cache->service );
+    free( cache->info );
+    free( cache );
+}
+
+static void WINAPI refresh_addrinfo_cache_callback( TP_CALLBACK_INSTANCE *instance, void *context )
+{
+    struct addrinfo_refresh_args *args = context;
+    struct addrinfo_cache_entry *cache;
+    struct addrinfo *info = NULL;
+    int ret;
+
+    ret = do_getaddrinfo( args->node, args->service, args->hints, &info );
+    if (is_addrinfo_cacheable( ret ))
+        store_addrinfo_cache( args->node, args->service, args->hints, ret, info, args->serial );
+    else
+    {
+        /* keep serving the old result until it expires */
+        EnterCriticalSection( &cs_addrinfo_cache );
+        if ((cache = find_addrinfo_cache( args->node, args->service, args->hints )))
+            cache->refreshing = FALSE;
+        LeaveCriticalSection( &cs_addrinfo_cache );
+    }
+
+    free( info );
+    free( args->node );
+    free( args->service );
+    FreeLibraryWhenCallbackReturns( instance, args->module );
+    free( args );
+}
+
+/* cs_addrinfo_cache must be held */
+static void refresh_addrinfo_cache( struct addrinfo_cache_entry *cache )
+{
+    struct addrinfo_refresh_args *args;
+
+    if (!(args = calloc( 1, sizeof(*args) + sizeof(*args->hints) ))) return;
+    if (!(args->node = strdup( cache->node )) || (cache->service && !(args->service = strdup( cache->service ))))
+        goto failed;
+    if (cache->has_hints)
+    {
+        args->hints = (struct addrinfo *)(args + 1);
+        args->hints->ai_flags    = cache->flags;
+        args->hints->ai_family   = cache->family;
+        args->hints->ai_socktype = cache->socktype;
+        args->hints->ai_protocol = cache->protocol;
+    }
+    args->serial = addrinfo_cache_serial;
+
+    if (!GetModuleHandleExW( GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                             (const WCHAR *)refresh_addrinfo_cache_callback, &args->module ))
+        goto failed;
+    if (TrySubmitThreadpoolCallback( refresh_addrinfo_cache_callback, args, NULL ))
+    {
+        cache->refreshing = TRUE;
+        return;
+    }
+    FreeLibrary( args->module );
+
+failed:
+    free( args->node );
+    free( args->service );
+    free( args );
+}
+
+/* numeric addresses don't need to be resolved, so they aren't worth caching */
+static BOOL is_numeric_host( const char *node, const struct addrinfo *hints )
+{
+    struct in6_addr addr6;
+    struct in_addr addr;
+
+    if (hints && (hints->ai_flags & AI_NUMERICHOST)) return TRUE;
+    /* host names never contain colons, this catches scoped and bracketed IPv6 addresses */
+    if (strchr( node, ':' )) return TRUE;
+    return inet_pton( AF_INET, node, &addr ) == 1 || inet_pton( AF_INET6, node, &addr6 ) == 1 ||
+           inet_addr( node ) != INADDR_NONE;
+}
+
+/* look up the cache, falling back to the host resolver */
+static int cached_getaddrinfo( const char *node, const char *service,
+                               const struct addrinfo *hints, struct addrinfo **info )
+{
+    struct addrinfo_cache_entry *cache;
+    ULONGLONG now = GetTickCount64();
+    unsigned int serial;
+    int ret = -1;
+
+    if (is_numeric_host( node, hints )) return do_getaddrinfo( node, service, hints, info );
+
+    InitOnceExecuteOnce( &addrinfo_cache_init_once, addrinfo_cache_init, NULL, NULL );
+
+    EnterCriticalSection( &cs_addrinfo_cache );
+    if ((cache = find_addrinfo_cache( node, service, hints )))
+    {
+        if (now >= cache->expire)
+            free_addrinfo_cache( cache );
+        else if (cache->error || (*info = copy_addrinfo_block( cache->info, cache->size )))
+        {
+            TRACE( "using cached result for %s\n", debugstr_a(node) );
+            ret = cache->error;
+            if (!ret && now >= cache->refresh && !cache->refreshing) refresh_addrinfo_cache( cache );
+            list_remove( &cache->entry );
+            list_add_head( &addrinfo_cache, &cache->entry );
+        }
+    }
+    serial = addrinfo_cache_serial;
+    LeaveCriticalSection( &cs_addrinfo_cache );
+    if (ret != -1) return ret;
+
+    ret = do_getaddrinfo( node, service, hints, info );
+    store_addrinfo_cache( node, service, hints, ret, *info, serial );
+    return ret;
+}
+
+/***********************************************************************
+ *      __wine_flush_addrinfo_cache   (ws2_32.@)
+ *
+ * Called by dnsapi to flush cached results for a given name, or all of them.
+ */
+void WINAPI __wine_flush_addrinfo_cache( const char *name )
+{
+    struct addrinfo_cache_entry *cache, *next;
+
+    TRACE( "%s\n", debugstr_a(name) );
+
+    EnterCriticalSection( &cs_addrinfo_cache );
+    LIST_FOR_EACH_ENTRY_SAFE( cache, next, &addrinfo_cache, struct addrinfo_cache_entry, entry )
+    {
+        if (!name || !strcasecmp( cache->node, name )) free_addrinfo_cache( cache );
+    }
+    addrinfo_cache_serial++;
+    LeaveCriticalSection( &cs_addrinfo_cache );
+}
+
 static int dns_only_query( const char *node, const struct addrinfo *hints, struct addrinfo **result )
 {
     DNS_STATUS status;
@@ -194,7 +504,8 @@ int WINAPI getaddrinfo( const char *node, const char *service,
         }
     }
 
-    ret = do_getaddrinfo( node, service, hints, info );
+    if (node) ret = cached_getaddrinfo( node, service, hints, info );
+    else ret = do_getaddrinfo( node, service, hints, info );
 
     if (ret && (!hints || !(hints->ai_flags & AI_NUMERICHOST)) && node)
     {
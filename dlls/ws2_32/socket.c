@@ -284,6 +284,13 @@ static inline const char *debugstr_sockopt(int level, int optname)
         }
         break;
 
+        DEBUG_SOCKLEVEL(IPPROTO_UDP);
+        switch(optname)
+        {
+            DEBUG_SOCKOPT(UDP_SEND_MSG_SIZE);
+        }
+        break;
+
         DEBUG_SOCKLEVEL(IPPROTO_IP);
         switch(optname)
         {
@@ -1681,6 +1688,18 @@ int WINAPI getsockopt( SOCKET s, int level, int optname, char *optval, int *optl
             return -1;
         }
 
+    case IPPROTO_UDP:
+        switch(optname)
+        {
+        case UDP_SEND_MSG_SIZE:
+            return server_getsockopt( s, IOCTL_AFD_WINE_GET_UDP_SEND_MSG_SIZE, optval, optlen );
+
+        default:
+            FIXME( "unrecognized UDP option %#x\n", optname );
+            SetLastError( WSAENOPROTOOPT );
+            return -1;
+        }
+
     case IPPROTO_IP:
         switch(optname)
         {
@@ -2909,6 +2928,19 @@ int WINAPI setsockopt( SOCKET s, int level, int optname, const char *optval, int
         }
         break;
 
+    case IPPROTO_UDP:
+        switch(optname)
+        {
+        case UDP_SEND_MSG_SIZE:
+            return server_setsockopt( s, IOCTL_AFD_WINE_SET_UDP_SEND_MSG_SIZE, optval, optlen );
+
+        default:
+            FIXME("Unknown IPPROTO_UDP optname 0x%08x\n", optname);
+            SetLastError(WSAENOPROTOOPT);
+            return SOCKET_ERROR;
+        }
+        break;
+
     case IPPROTO_IP:
         switch(optname)
         {
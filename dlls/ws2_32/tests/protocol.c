@@ -44,6 +44,7 @@ static const WCHAR *(WINAPI *pInetNtopW)(int family, void *addr, WCHAR *string,
 static int (WINAPI *p_inet_pton)(int family, const char *string, void *addr);
 static int (WINAPI *pInetPtonW)(int family, WCHAR *string, void *addr);
 static int (WINAPI *pWSCGetProviderInfo)(GUID *provider, WSC_PROVIDER_INFO_TYPE type, BYTE *info, size_t *size, DWORD flags, INT *err);
+static void (WINAPI *pDnsFlushResolverCache)(void);
 
 /* TCP and UDP over IP fixed set of service flags */
 #define TCPIP_SERVICE_FLAGS (XP1_GUARANTEED_DELIVERY \
@@ -2328,6 +2329,62 @@ static void test_getaddrinfo(void)
         }
     }
 
+    /* cached results match fresh ones, and differing hints don't share results */
+    pDnsFlushResolverCache = (void *)GetProcAddress(LoadLibraryA("dnsapi.dll"), "DnsFlushResolverCache");
+    if (pDnsFlushResolverCache) pDnsFlushResolverCache();
+    memset(&hint, 0, sizeof(hint));
+    hint.ai_family = AF_INET;
+    hint.ai_socktype = SOCK_STREAM;
+    result = NULL;
+    ret = getaddrinfo("localhost", "80", &hint, &result);
+    ok(!ret, "getaddrinfo failed with %d\n", WSAGetLastError());
+    result2 = NULL;
+    ret = getaddrinfo("LocalHost", "80", &hint, &result2);
+    ok(!ret, "getaddrinfo failed with %d\n", WSAGetLastError());
+    ok(result != result2, "got the same list\n");
+    compare_addrinfo(result, result2);
+    freeaddrinfo(result2);
+
+    hint.ai_socktype = SOCK_DGRAM;
+    result2 = NULL;
+    ret = getaddrinfo("localhost", "80", &hint, &result2);
+    ok(!ret, "getaddrinfo failed with %d\n", WSAGetLastError());
+    for (p = result2; p; p = p->ai_next)
+    {
+        ok(p->ai_socktype == SOCK_DGRAM, "got socktype %d\n", p->ai_socktype);
+        sockaddr = (SOCKADDR_IN *)p->ai_addr;
+        ok(sockaddr->sin_family == AF_INET, "ai_addr->sin_family == %d\n", sockaddr->sin_family);
+        ok(sockaddr->sin_port == htons(80), "ai_addr->sin_port == %d\n", sockaddr->sin_port);
+    }
+    freeaddrinfo(result2);
+
+    hint.ai_socktype = SOCK_STREAM;
+    hint.ai_flags = AI_CANONNAME;
+    result2 = NULL;
+    ret = getaddrinfo("localhost", "80", &hint, &result2);
+    ok(!ret, "getaddrinfo failed with %d\n", WSAGetLastError());
+    ok(result2 && result2->ai_canonname != NULL, "expected a canonical name\n");
+    freeaddrinfo(result2);
+
+    hint.ai_flags = 0;
+    result2 = NULL;
+    ret = getaddrinfo("localhost", "80", &hint, &result2);
+    ok(!ret, "getaddrinfo failed with %d\n", WSAGetLastError());
+    ok(result2 && !result2->ai_canonname, "got canonical name %s\n", result2 ? result2->ai_canonname : NULL);
+    compare_addrinfo(result, result2);
+    freeaddrinfo(result2);
+
+    result2 = NULL;
+    ret = getaddrinfo("localhost", "81", &hint, &result2);
+    ok(!ret, "getaddrinfo failed with %d\n", WSAGetLastError());
+    for (p = result2; p; p = p->ai_next)
+    {
+        sockaddr = (SOCKADDR_IN *)p->ai_addr;
+        ok(sockaddr->sin_port == htons(81), "ai_addr->sin_port == %d\n", sockaddr->sin_port);
+    }
+    freeaddrinfo(result2);
+    freeaddrinfo(result);
+
     memset(&hint, 0, sizeof(hint));
     ret = getaddrinfo(NULL, "nonexistentservice", &hint, &result);
     ok(ret == WSATYPE_NOT_FOUND, "got %d\n", ret);
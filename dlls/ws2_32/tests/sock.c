@@ -1705,6 +1705,55 @@ todo_wine
     }
 }
 
+static void test_udp_send_msg_size(void)
+{
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+    int len = sizeof(addr), size, ret, i;
+    SOCKET client, server;
+    char buffer[3000];
+    DWORD value;
+
+    server = socket(AF_INET, SOCK_DGRAM, 0);
+    ok(server != INVALID_SOCKET, "failed to create socket, error %u\n", WSAGetLastError());
+    ret = bind(server, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!ret, "failed to bind, error %u\n", WSAGetLastError());
+    ret = getsockname(server, (struct sockaddr *)&addr, &len);
+    ok(!ret, "failed to get address, error %u\n", WSAGetLastError());
+
+    client = socket(AF_INET, SOCK_DGRAM, 0);
+    ok(client != INVALID_SOCKET, "failed to create socket, error %u\n", WSAGetLastError());
+
+    value = 1000;
+    ret = setsockopt(client, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, sizeof(value));
+    if (ret)
+    {
+        win_skip("UDP_SEND_MSG_SIZE is not supported, error %u\n", WSAGetLastError());
+        closesocket(client);
+        closesocket(server);
+        return;
+    }
+
+    value = 0xdeadbeef;
+    size = sizeof(value);
+    ret = getsockopt(client, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char *)&value, &size);
+    ok(!ret, "got error %u\n", WSAGetLastError());
+    ok(value == 1000, "got %u\n", value);
+
+    /* a single send is split into datagrams of the given size */
+    memset(buffer, 'a', sizeof(buffer));
+    ret = sendto(client, buffer, sizeof(buffer), 0, (struct sockaddr *)&addr, sizeof(addr));
+    ok(ret == sizeof(buffer), "got %d, error %u\n", ret, WSAGetLastError());
+
+    for (i = 0; i < 3; ++i)
+    {
+        ret = recv(server, buffer, sizeof(buffer), 0);
+        ok(ret == 1000, "datagram %d: got %d, error %u\n", i, ret, WSAGetLastError());
+    }
+
+    closesocket(client);
+    closesocket(server);
+}
+
 static void test_so_reuseaddr(void)
 {
     struct sockaddr_in saddr;
@@ -8184,6 +8233,11 @@ static void test_TransmitFile(void)
     char header_msg[] = "hello world";
     char footer_msg[] = "goodbye!!!";
     char system_ini_path[MAX_PATH];
+    char temp_path[MAX_PATH], big_file_path[MAX_PATH];
+    unsigned int i, total_received;
+    char *big_data, *received;
+    HANDLE big_file;
+    DWORD timeout;
     struct sockaddr_in bindAddress;
     TRANSMIT_FILE_BUFFERS buffers;
     SOCKET client, server, dest;
@@ -8337,6 +8391,51 @@ static void test_TransmitFile(void)
     ok(memcmp(buf, &footer_msg[0], sizeof(footer_msg)) == 0,
        "TransmitFile footer buffer did not match!\n");
 
+    /* Test a file larger than the transfer buffer, with buffer data, an
+     * offset, a partial length and TF_DISCONNECT */
+    GetTempPathA(ARRAY_SIZE(temp_path), temp_path);
+    GetTempFileNameA(temp_path, "wst", 0, big_file_path);
+    big_file = CreateFileA(big_file_path, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                           CREATE_ALWAYS, FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    ok(big_file != INVALID_HANDLE_VALUE, "failed to create file, error %u\n", GetLastError());
+    big_data = malloc(100000);
+    for (i = 0; i < 100000; i++) big_data[i] = i * 13 + (i >> 8);
+    bret = WriteFile(big_file, big_data, 100000, &num_bytes, NULL);
+    ok(bret && num_bytes == 100000, "failed to write file, error %u\n", GetLastError());
+
+    iret = set_blocking(dest, TRUE);
+    ok(!iret, "failed to set blocking, error %u\n", GetLastError());
+    timeout = 5000;
+    iret = setsockopt(dest, SOL_SOCKET, SO_RCVTIMEO, (char *)&timeout, sizeof(timeout));
+    ok(!iret, "failed to set receive timeout, error %u\n", GetLastError());
+
+    ov.hEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    ov.Offset = 1000;
+    bret = pTransmitFile(client, big_file, 50000, 4096, &ov, &buffers, TF_DISCONNECT);
+    err = WSAGetLastError();
+    ok(bret || err == ERROR_IO_PENDING, "TransmitFile failed, error %u\n", err);
+    iret = WaitForSingleObject(ov.hEvent, 5000);
+    ok(iret == WAIT_OBJECT_0, "Overlapped TransmitFile failed.\n");
+    WSAGetOverlappedResult(client, &ov, &total_sent, FALSE, NULL);
+    ok(total_sent == 50000 + buffers.HeadLength + buffers.TailLength,
+       "Overlapped TransmitFile sent an unexpected number of bytes (%d).\n", total_sent);
+
+    received = malloc(60000);
+    total_received = 0;
+    while ((iret = recv(dest, received + total_received, 60000 - total_received, 0)) > 0)
+        total_received += iret;
+    ok(!iret, "expected the connection to be closed, got %d, error %u\n", iret, WSAGetLastError());
+    ok(total_received == total_sent, "received %u bytes\n", total_received);
+    ok(!memcmp(received, header_msg, sizeof(header_msg)), "TransmitFile header buffer did not match!\n");
+    ok(!memcmp(received + sizeof(header_msg), big_data + 1000, 50000), "TransmitFile file data did not match!\n");
+    ok(!memcmp(received + sizeof(header_msg) + 50000, footer_msg, sizeof(footer_msg)),
+       "TransmitFile footer buffer did not match!\n");
+
+    free(received);
+    free(big_data);
+    CloseHandle(big_file);
+    closesocket(dest);
+
     /* Test TransmitFile with a UDP datagram socket */
     closesocket(client);
     client = socket(AF_INET, SOCK_DGRAM, 0);
@@ -12037,6 +12136,7 @@ START_TEST( sock )
     Init();
 
     test_set_getsockopt();
+    test_udp_send_msg_size();
     test_so_reuseaddr();
     test_ip_pktinfo();
     test_ipv4_cmsg();
@@ -133,3 +133,6 @@
 @ stdcall getnameinfo(ptr long ptr long ptr long long)
 @ stdcall inet_ntop(long ptr ptr long)
 @ stdcall inet_pton(long str ptr)
+
+# Wine extensions
+@ stdcall -private __wine_flush_addrinfo_cache(str)
@@ -36,6 +36,7 @@
 #include "winuser.h"
 #include "winerror.h"
 #include "winnls.h"
+#include "winreg.h"
 #include "winsock2.h"
 #include "mswsock.h"
 #include "ws2tcpip.h"
@@ -52,6 +53,7 @@
 #include "windns.h"
 #include "wine/afd.h"
 #include "wine/debug.h"
+#include "wine/list.h"
 #include "wine/unixlib.h"
 
 #define DECLARE_CRITICAL_SECTION(cs) \
@@ -352,6 +352,25 @@ static void shrink_handle_table( struct handle_table *table )
     table->entries = new_entries;
 }
 
+/* return the table index of an inheritable handle, or -1 */
+static int get_inheritable_index( struct process *parent, obj_handle_t handle )
+{
+    struct handle_entry *entry;
+
+    if (handle_is_global( handle )) return -1;
+    if (!(entry = get_handle( parent, handle )) || !(entry->access & RESERVED_INHERIT)) return -1;
+    return handle_to_index( handle );
+}
+
+/* size of a table holding entries up to the given index, following the growth of the tables */
+static int get_handle_table_size( int last )
+{
+    int count = MIN_HANDLE_ENTRIES;
+
+    while (count <= last) count *= 2;
+    return count;
+}
+
 static void inherit_handle( struct process *parent, const obj_handle_t handle, struct handle_table *table )
 {
     struct handle_entry *dst, *src;
@@ -359,10 +378,9 @@ static void inherit_handle( struct process *parent, const obj_handle_t handle, s
 
     dst = table->entries;
 
-    src = get_handle( parent, handle );
-    if (!src || !(src->access & RESERVED_INHERIT)) return;
-    index = handle_to_index( handle );
+    if ((index = get_inheritable_index( parent, handle )) < 0) return;
     if (dst[index].ptr) return;
+    src = get_handle( parent, handle );
     grab_object_for_handle( src->ptr );
     dst[index] = *src;
     table->last = max( table->last, index );
@@ -376,17 +394,32 @@ struct handle_table *copy_handle_table( struct process *process, struct process
 {
     struct handle_table *parent_table = parent->handles;
     struct handle_table *table;
-    int i;
+    int i, last = -1;
 
     assert( parent_table );
     assert( parent_table->obj.ops == &handle_table_ops );
 
-    if (!(table = alloc_handle_table( process, parent_table->count )))
+    /* only allocate and copy entries up to the last one that gets inherited */
+    if (handles)
+    {
+        for (i = 0; i < handle_count; i++) last = max( last, get_inheritable_index( parent, handles[i] ));
+        for (i = 0; i < 3; i++) last = max( last, get_inheritable_index( parent, std_handles[i] ));
+    }
+    else
+    {
+        for (last = parent_table->last; last >= 0; last--)
+        {
+            const struct handle_entry *entry = parent_table->entries + last;
+            if (entry->ptr && (entry->access & RESERVED_INHERIT)) break;
+        }
+    }
+
+    if (!(table = alloc_handle_table( process, get_handle_table_size( last ))))
         return NULL;
 
     if (handles)
     {
-        memset( table->entries, 0, parent_table->count * sizeof(*table->entries) );
+        memset( table->entries, 0, (last + 1) * sizeof(*table->entries) );
 
         for (i = 0; i < handle_count; i++)
         {
@@ -400,7 +433,7 @@ struct handle_table *copy_handle_table( struct process *process, struct process
     }
     else
     {
-        if ((table->last = parent_table->last) >= 0)
+        if ((table->last = last) >= 0)
         {
             struct handle_entry *ptr = table->entries;
             memcpy( ptr, parent_table->entries, (table->last + 1) * sizeof(struct handle_entry) );
@@ -46,9 +46,16 @@
 struct namespace
 {
     unsigned int        hash_size;       /* size of hash table */
-    struct list         names[1];        /* array of hash entry lists */
+    unsigned int        count;           /* number of names in the namespace */
+    struct list        *names;           /* array of hash entry lists */
+    unsigned int        old_size;        /* size of the previous hash table while rehashing */
+    unsigned int        rehash_pos;      /* next bucket of the previous table to move */
+    struct list        *old_names;       /* previous hash table, NULL when not rehashing */
 };
 
+#define NAMESPACE_MAX_LOAD     2  /* average bucket length that triggers a resize */
+#define NAMESPACE_REHASH_STEP  2  /* buckets moved to the new table on each insertion */
+
 
 struct type_descr no_type =
 {
@@ -134,11 +141,59 @@ void *memdup( const void *data, size_t len )
 
 /*****************************************************************/
 
+/* move a few buckets of the previous hash table to the current one */
+static void namespace_rehash_step( struct namespace *namespace, unsigned int count )
+{
+    struct object_name *ptr, *next;
+    unsigned int hash;
+
+    while (namespace->old_names && count--)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE( ptr, next, &namespace->old_names[namespace->rehash_pos],
+                                  struct object_name, entry )
+        {
+            hash = hash_strW( ptr->name, ptr->len, namespace->hash_size );
+            list_remove( &ptr->entry );
+            list_add_head( &namespace->names[hash], &ptr->entry );
+        }
+        if (++namespace->rehash_pos < namespace->old_size) continue;
+        free( namespace->old_names );
+        namespace->old_names = NULL;
+        namespace->old_size = namespace->rehash_pos = 0;
+    }
+}
+
+/* grow the hash table; entries are moved over incrementally by namespace_rehash_step */
+static void namespace_grow( struct namespace *namespace )
+{
+    unsigned int i, new_size = namespace->hash_size * 2 + 1;
+    struct list *names;
+
+    /* finish any pending rehash first, there can only be one previous table */
+    if (namespace->old_names) namespace_rehash_step( namespace, namespace->old_size );
+
+    /* failing to grow is not fatal, lookups only get slower */
+    if (!(names = malloc( new_size * sizeof(*names) ))) return;
+    for (i = 0; i < new_size; i++) list_init( &names[i] );
+
+    namespace->old_names  = namespace->names;
+    namespace->old_size   = namespace->hash_size;
+    namespace->rehash_pos = 0;
+    namespace->names      = names;
+    namespace->hash_size  = new_size;
+}
+
 void namespace_add( struct namespace *namespace, struct object_name *ptr )
 {
-    unsigned int hash = hash_strW( ptr->name, ptr->len, namespace->hash_size );
+    unsigned int hash;
 
+    if (namespace->count >= namespace->hash_size * NAMESPACE_MAX_LOAD) namespace_grow( namespace );
+    else namespace_rehash_step( namespace, NAMESPACE_REHASH_STEP );
+
+    hash = hash_strW( ptr->name, ptr->len, namespace->hash_size );
     list_add_head( &namespace->names[hash], &ptr->entry );
+    ptr->namespace = namespace;
+    namespace->count++;
 }
 
 /* allocate a name for an object */
@@ -150,6 +205,7 @@ static struct object_name *alloc_name( const struct unicode_str *name )
     {
         ptr->len = name->len;
         ptr->parent = NULL;
+        ptr->namespace = NULL;
         memcpy( ptr->name, name->str, name->len );
     }
     return ptr;
@@ -443,16 +499,12 @@ void release_object( void *ptr )
     }
 }
 
-/* find an object by its name; the refcount is incremented */
-struct object *find_object( const struct namespace *namespace, const struct unicode_str *name,
-                            unsigned int attributes )
+/* find an object by its name in a single hash bucket */
+static struct object *find_object_in_list( const struct list *list, const struct unicode_str *name,
+                                           unsigned int attributes )
 {
-    const struct list *list;
     struct list *p;
 
-    if (!name || !name->len) return NULL;
-
-    list = &namespace->names[ hash_strW( name->str, name->len, namespace->hash_size ) ];
     LIST_FOR_EACH( p, list )
     {
         const struct object_name *ptr = LIST_ENTRY( p, struct object_name, entry );
@@ -471,20 +523,56 @@ struct object *find_object( const struct namespace *namespace, const struct unic
     return NULL;
 }
 
-/* find an object by its index; the refcount is incremented */
-struct object *find_object_index( const struct namespace *namespace, unsigned int index )
+/* find an object by its name; the refcount is incremented */
+struct object *find_object( const struct namespace *namespace, const struct unicode_str *name,
+                            unsigned int attributes )
 {
+    struct object *obj;
+    unsigned int hash;
+
+    if (!name || !name->len) return NULL;
+
+    hash = hash_strW( name->str, name->len, namespace->hash_size );
+    if ((obj = find_object_in_list( &namespace->names[hash], name, attributes ))) return obj;
+    if (!namespace->old_names) return NULL;
+
+    /* the name may still be in a bucket of the previous table that hasn't been moved yet */
+    hash = hash_strW( name->str, name->len, namespace->old_size );
+    if (hash < namespace->rehash_pos) return NULL;
+    return find_object_in_list( &namespace->old_names[hash], name, attributes );
+}
+
+/* find an object by its index in a hash table */
+static struct object *find_object_index_in_table( const struct list *names, unsigned int size,
+                                                  unsigned int *index )
+{
+    const struct object_name *ptr;
     unsigned int i;
 
-    /* FIXME: not efficient at all */
-    for (i = 0; i < namespace->hash_size; i++)
+    for (i = 0; i < size; i++)
     {
-        const struct object_name *ptr;
-        LIST_FOR_EACH_ENTRY( ptr, &namespace->names[i], const struct object_name, entry )
+        LIST_FOR_EACH_ENTRY( ptr, &names[i], const struct object_name, entry )
         {
-            if (!index--) return grab_object( ptr->obj );
+            if (!(*index)--) return grab_object( ptr->obj );
         }
     }
+    return NULL;
+}
+
+/* find an object by its index; the refcount is incremented */
+struct object *find_object_index( const struct namespace *namespace, unsigned int index )
+{
+    struct object *obj;
+
+    /* FIXME: not efficient at all */
+    if (index < namespace->count)
+    {
+        if ((obj = find_object_index_in_table( namespace->names, namespace->hash_size, &index )))
+            return obj;
+        if (namespace->old_names &&
+            (obj = find_object_index_in_table( namespace->old_names, namespace->old_size, &index )))
+            return obj;
+    }
     set_error( STATUS_NO_MORE_ENTRIES );
     return NULL;
 }
@@ -495,15 +583,30 @@ struct namespace *create_namespace( unsigned int hash_size )
     struct namespace *namespace;
     unsigned int i;
 
-    namespace = mem_alloc( sizeof(*namespace) + (hash_size - 1) * sizeof(namespace->names[0]) );
-    if (namespace)
+    if (!(namespace = mem_alloc( sizeof(*namespace) ))) return NULL;
+    if (!(namespace->names = mem_alloc( hash_size * sizeof(namespace->names[0]) )))
     {
-        namespace->hash_size      = hash_size;
-        for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
+        free( namespace );
+        return NULL;
     }
+    namespace->hash_size  = hash_size;
+    namespace->count      = 0;
+    namespace->old_names  = NULL;
+    namespace->old_size   = 0;
+    namespace->rehash_pos = 0;
+    for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
     return namespace;
 }
 
+/* free a namespace */
+void free_namespace( struct namespace *namespace )
+{
+    if (!namespace) return;
+    free( namespace->old_names );
+    free( namespace->names );
+    free( namespace );
+}
+
 /* functions for unimplemented/default object operations */
 
 int no_add_queue( struct object *obj, struct wait_queue_entry *entry )
@@ -691,6 +794,8 @@ int no_link_name( struct object *obj, struct object_name *name, struct object *p
 void default_unlink_name( struct object *obj, struct object_name *name )
 {
     list_remove( &name->entry );
+    if (name->namespace) name->namespace->count--;
+    name->namespace = NULL;
 }
 
 struct object *no_open_file( struct object *obj, unsigned int access, unsigned int sharing,
@@ -116,6 +116,19 @@ union win_sockaddr
 
 static struct list poll_list = LIST_INIT( poll_list );
 
+struct poll_req;
+
+struct poll_req_socket
+{
+    struct list entry;      /* entry in the socket's list of polls */
+    struct poll_req *req;   /* request this entry belongs to */
+    struct sock *sock;
+    int mask;
+    obj_handle_t handle;
+    int flags;
+    unsigned int status;
+};
+
 struct poll_req
 {
     struct list entry;
@@ -125,14 +138,7 @@ struct poll_req
     timeout_t orig_timeout;
     int exclusive;
     unsigned int count;
-    struct
-    {
-        struct sock *sock;
-        int mask;
-        obj_handle_t handle;
-        int flags;
-        unsigned int status;
-    } sockets[1];
+    struct poll_req_socket sockets[1];
 };
 
 struct accept_req
@@ -204,6 +210,7 @@ struct sock
     struct accept_req  *accept_recv_req; /* pending accept-into request which will recv on this socket */
     struct connect_req *connect_req; /* pending connection request */
     struct poll_req    *main_poll;   /* main poll */
+    struct list         poll_list;   /* list of poll requests waiting on this socket */
     union win_sockaddr  addr;        /* socket name */
     int                 addr_len;    /* socket name length */
     unsigned int        rcvbuf;      /* advisory recv buffer size */
@@ -791,7 +798,10 @@ static void free_poll_req( void *private )
     if (req->timeout) remove_timeout_user( req->timeout );
 
     for (i = 0; i < req->count; ++i)
+    {
+        list_remove( &req->sockets[i].entry );
         release_object( req->sockets[i].sock );
+    }
     release_object( req->async );
     release_object( req->iosb );
     list_remove( &req->entry );
@@ -911,29 +921,28 @@ static void complete_async_poll( struct poll_req *req, unsigned int status )
 static void complete_async_polls( struct sock *sock, int event, int error )
 {
     int flags = get_poll_flags( sock, event );
-    struct poll_req *req, *next;
+    struct poll_req_socket *poll_sock;
 
-    LIST_FOR_EACH_ENTRY_SAFE( req, next, &poll_list, struct poll_req, entry )
+    /* completing a request may free it, along with any other entry it has in
+     * this list, so start over after each completion; completed requests are
+     * skipped, which guarantees progress */
+restart:
+    LIST_FOR_EACH_ENTRY( poll_sock, &sock->poll_list, struct poll_req_socket, entry )
     {
-        unsigned int i;
+        struct poll_req *req = poll_sock->req;
 
         if (req->iosb->status != STATUS_PENDING) continue;
+        if (!(poll_sock->mask & flags)) continue;
 
-        for (i = 0; i < req->count; ++i)
-        {
-            if (req->sockets[i].sock != sock) continue;
-            if (!(req->sockets[i].mask & flags)) continue;
-
-            if (debug_level)
-                fprintf( stderr, "completing poll for socket %p, wanted %#x got %#x\n",
-                         sock, req->sockets[i].mask, flags );
+        if (debug_level)
+            fprintf( stderr, "completing poll for socket %p, wanted %#x got %#x\n",
+                     sock, poll_sock->mask, flags );
 
-            req->sockets[i].flags = req->sockets[i].mask & flags;
-            req->sockets[i].status = sock_get_ntstatus( error );
+        poll_sock->flags = poll_sock->mask & flags;
+        poll_sock->status = sock_get_ntstatus( error );
 
-            complete_async_poll( req, STATUS_SUCCESS );
-            break;
-        }
+        complete_async_poll( req, STATUS_SUCCESS );
+        goto restart;
     }
 }
 
@@ -1191,7 +1200,7 @@ static int sock_get_poll_events( struct fd *fd )
 {
     struct sock *sock = get_fd_user( fd );
     unsigned int mask = sock->mask & ~sock->reported_events;
-    struct poll_req *req;
+    struct poll_req_socket *poll_sock;
     int ev = 0;
 
     assert( sock->obj.ops == &sock_ops );
@@ -1272,17 +1281,8 @@ static int sock_get_poll_events( struct fd *fd )
         break;
     }
 
-    LIST_FOR_EACH_ENTRY( req, &poll_list, struct poll_req, entry )
-    {
-        unsigned int i;
-
-        for (i = 0; i < req->count; ++i)
-        {
-            if (req->sockets[i].sock != sock) continue;
-
-            ev |= poll_flags_from_afd( sock, req->sockets[i].mask );
-        }
-    }
+    LIST_FOR_EACH_ENTRY( poll_sock, &sock->poll_list, struct poll_req_socket, entry )
+        ev |= poll_flags_from_afd( sock, poll_sock->mask );
 
     return ev;
 }
@@ -1389,7 +1389,7 @@ static int sock_close_handle( struct object *obj, struct process *process, obj_h
     if (sock->obj.handle_count == 1) /* last handle */
     {
         struct accept_req *accept_req, *accept_next;
-        struct poll_req *poll_req, *poll_next;
+        struct poll_req_socket *poll_sock;
 
         if (sock->accept_recv_req)
             async_terminate( sock->accept_recv_req->async, STATUS_CANCELLED );
@@ -1400,25 +1400,25 @@ static int sock_close_handle( struct object *obj, struct process *process, obj_h
         if (sock->connect_req)
             async_terminate( sock->connect_req->async, STATUS_CANCELLED );
 
-        LIST_FOR_EACH_ENTRY_SAFE( poll_req, poll_next, &poll_list, struct poll_req, entry )
+    restart:
+        LIST_FOR_EACH_ENTRY( poll_sock, &sock->poll_list, struct poll_req_socket, entry )
         {
-            struct iosb *iosb = poll_req->iosb;
-            BOOL signaled = FALSE;
+            struct poll_req *poll_req = poll_sock->req;
             unsigned int i;
 
-            if (iosb->status != STATUS_PENDING) continue;
+            if (poll_req->iosb->status != STATUS_PENDING) continue;
 
             for (i = 0; i < poll_req->count; ++i)
             {
                 if (poll_req->sockets[i].sock == sock)
                 {
-                    signaled = TRUE;
                     poll_req->sockets[i].flags = AFD_POLL_CLOSE;
                     poll_req->sockets[i].status = 0;
                 }
             }
 
-            if (signaled) complete_async_poll( poll_req, STATUS_SUCCESS );
+            complete_async_poll( poll_req, STATUS_SUCCESS );
+            goto restart;
         }
     }
 
@@ -1498,6 +1498,7 @@ static struct sock *create_socket(void)
     init_async_queue( &sock->poll_q );
     memset( sock->errors, 0, sizeof(sock->errors) );
     list_init( &sock->accept_list );
+    list_init( &sock->poll_list );
     return sock;
 }
 
@@ -3046,7 +3047,7 @@ static void poll_socket( struct sock *poll_sock, struct async *async, int exclus
         req->sockets[i].sock = (struct sock *)get_handle_obj( current->process, sockets[i].socket, 0, &sock_ops );
         if (!req->sockets[i].sock)
         {
-            for (j = 0; j < i; ++j) release_object( req->sockets[i].sock );
+            for (j = 0; j < i; ++j) release_object( req->sockets[j].sock );
             if (req->timeout) remove_timeout_user( req->timeout );
             free( req );
             return;
@@ -3064,6 +3065,11 @@ static void poll_socket( struct sock *poll_sock, struct async *async, int exclus
     handle_exclusive_poll(req);
 
     list_add_tail( &poll_list, &req->entry );
+    for (i = 0; i < count; ++i)
+    {
+        req->sockets[i].req = req;
+        list_add_tail( &req->sockets[i].sock->poll_list, &req->sockets[i].entry );
+    }
     async_set_completion_callback( async, free_poll_req, req );
     queue_async( &poll_sock->poll_q, async );
 